@@ -0,0 +1,57 @@
+// Compares allocating AST nodes in an AstArena with allocating each one with
+// new and freeing it with delete, as nodes were before, and measures parsing
+// a generated program into a fresh arena and into a reused one.
+//
+// Usage: bench/arena
+
+#include "precompile.h"
+
+#include <memory>
+#include <vector>
+#include <cstdio>
+
+#include "ast.h"
+#include "arena.h"
+#include "parser.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+int main() {
+    const int runs = 5;
+    const size_t num_nodes = 4000000;
+    Token token;
+    token.type = 0;
+    token.loc = {0};
+    token.len = 0;
+    token.number = Token::Number();
+
+    bench::report("new and delete", bench::best_of(runs, [&] {
+        std::vector<std::unique_ptr<ast::NumberExpr>> nodes;
+        nodes.reserve(num_nodes);
+        for (size_t i = 0; i < num_nodes; ++i) nodes.emplace_back(new ast::NumberExpr(token));
+        bench::keep(nodes.back());
+    }), num_nodes, "node");
+
+    bench::report("fresh arena", bench::best_of(runs, [&] {
+        AstArena arena;
+        for (size_t i = 0; i < num_nodes; ++i) bench::keep(arena.make<ast::NumberExpr>(token));
+    }), num_nodes, "node");
+
+    AstArena warm;
+    bench::report("reused arena", bench::best_of(runs, [&] {
+        warm.reset();
+        for (size_t i = 0; i < num_nodes; ++i) bench::keep(warm.make<ast::NumberExpr>(token));
+    }), num_nodes, "node");
+
+    const Source& src = make_source(bench::generate_program(500000), "<generated>");
+    bench::report("parse into fresh arena", bench::best_of(runs, [&] {
+        bench::keep(parse(src).errors.size());
+    }), src.code_size, "B");
+
+    bench::report("parse into reused arena", bench::best_of(runs, [&] {
+        warm.reset();
+        bench::keep(parse(src, ParseMode::STREAMING, &warm).errors.size());
+    }), src.code_size, "B");
+}
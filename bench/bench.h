@@ -0,0 +1,73 @@
+#ifndef KWIK_BENCH_H
+#define KWIK_BENCH_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+
+
+// Helpers shared by the benchmarks. A benchmark runs every measurement a few
+// times and reports the fastest run, which is the least disturbed by the rest
+// of the machine.
+namespace bench {
+    // Returns the fastest of runs calls to f, in seconds.
+    template<class F>
+    double best_of(int runs, F f) {
+        double best = 1e300;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+
+        return best;
+    }
+
+    // Keeps the compiler from optimizing away the computation of x.
+    template<class T>
+    inline void keep(const T& x) { asm volatile("" : : "r"(&x) : "memory"); }
+
+    // Generates a valid program of about lines lines, in the style of
+    // machine-generated code: numbered lets with trailing comments, typed
+    // aliases of earlier names and small nested blocks. With unicode the
+    // comments are mostly non-ASCII text.
+    inline std::string generate_program(size_t lines, bool unicode = false, uint32_t seed = 1) {
+        static const char* ascii_comments[] = {"# set up the next value", "# TODO: fold constants", "# alias"};
+        static const char* unicode_comments[] = {"# σύνολο τιμών για τον έλεγχο", "# 次の値を準備する",
+                                                 "# значение по умолчанию ✓"};
+        auto comments = unicode ? unicode_comments : ascii_comments;
+
+        // Aliases may only refer to names bound at the top level.
+        std::vector<size_t> top_level;
+        std::mt19937 rng(seed);
+        std::string code = "{\n";
+        for (size_t i = 0; i < lines; ++i) {
+            std::string name = "value_" + std::to_string(i);
+            uint32_t kind = rng() % 10;
+            if (top_level.empty() || kind < 5) {
+                code += "    let " + name + " = " + std::to_string(rng() % 1000000) + "  " + comments[rng() % 3] + "\n";
+                top_level.push_back(i);
+            } else if (kind < 8) {
+                code += "    let " + name + ": I64 = (value_" + std::to_string(top_level[rng() % top_level.size()]) + ")\n";
+                top_level.push_back(i);
+            } else {
+                code += "    { let " + name + " = 0x" + std::to_string(rng() % 100000) + "; let inner = " + name + " }\n";
+            }
+        }
+
+        code += "}\n";
+        return code;
+    }
+
+    // Prints a time and the throughput in millions of unit per second.
+    inline void report(const char* what, double seconds, double units, const char* unit) {
+        std::printf("%-36s %10.3f ms %10.1f M%s/s\n", what, seconds * 1e3, units / seconds / 1e6, unit);
+    }
+}
+
+#endif
@@ -0,0 +1,79 @@
+// Compares the flat AST with the pointer AST on a large generated program:
+// the memory per node, counting the child arrays of compound statements with
+// the pointer nodes, and the time to check each form. The token buffer both
+// need isn't counted.
+//
+// Usage: bench/flatast [<lines>]
+//
+// Lines defaults to 300000, about 780k nodes.
+
+#include "precompile.h"
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include "libop/op.h"
+
+#include "flatast.h"
+#include "parser.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+// Adds up the memory of the nodes of a pointer AST.
+struct Sizer : ast::AstVisitor<Sizer> {
+    size_t nodes = 0;
+    size_t bytes = 0;
+
+    void enter(ast::Node* node) {
+        ++nodes;
+        switch (node->kind) {
+        case ast::NodeKind::NUMBER: bytes += sizeof(ast::NumberExpr); break;
+        case ast::NodeKind::NAME: bytes += sizeof(ast::NameExpr); break;
+        case ast::NodeKind::LET: bytes += sizeof(ast::LetStmt); break;
+        case ast::NodeKind::RETURN: bytes += sizeof(ast::ReturnStmt); break;
+        case ast::NodeKind::COMPOUND: {
+            auto compound = static_cast<ast::CompoundStmt*>(node);
+            bytes += sizeof(ast::CompoundStmt) + compound->stmt_list.size * sizeof(ast::Stmt*);
+            break;
+        }
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    const int runs = 5;
+    size_t lines = argc > 1 ? std::atoi(argv[1]) : 300000;
+    const Source& src = make_source(bench::generate_program(lines), "generated.kw");
+
+    AstArena arena;
+    ParseResult result = parse(src, ParseMode::PRELEXED, &arena);
+    if (!result.program || !result.errors.empty()) {
+        std::printf("the generated program doesn't check\n");
+        return 1;
+    }
+
+    TokenBuffer tokens;
+    Lexer{src}.lex_all(tokens);
+    FlatAst flat = flatten(result.program, tokens);
+
+    Sizer sizer;
+    sizer.visit(result.program);
+    size_t flat_bytes = flat.size() * (sizeof(ast::NodeKind) + 2 * sizeof(uint32_t));
+    std::printf("%zu nodes\n", sizer.nodes);
+    std::printf("pointer AST %6.1f B/node\n", double(sizer.bytes) / sizer.nodes);
+    std::printf("flat AST    %6.1f B/node, %.1fx smaller\n", double(flat_bytes) / flat.size(),
+                double(sizer.bytes) / flat_bytes);
+
+    bench::report("check pointer AST", bench::best_of(runs, [&] {
+        ast::Environment env;
+        ast::check(result.program, env);
+    }), sizer.nodes, "node");
+    bench::report("flatten", bench::best_of(runs, [&] {
+        bench::keep(flatten(result.program, tokens));
+    }), sizer.nodes, "node");
+    bench::report("check flat AST", bench::best_of(runs, [&] {
+        check(flat, tokens);
+    }), sizer.nodes, "node");
+}
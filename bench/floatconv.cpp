@@ -0,0 +1,73 @@
+// Compares parse_f64 and parse_f32 with strtod and strtof, on millions of
+// float literals of three kinds: short ones as people write them, ones with
+// all 17 significant digits of a random double, and ones with 9 digits of a
+// random float.
+//
+// Usage: bench/floatconv
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "floatconv.h"
+#include "bench.h"
+
+
+// Writes x with sig significant digits and without exponent.
+static std::string plain_decimal(double x, int sig) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.*e", sig - 1, x);
+
+    std::string digits;
+    char* p = buf;
+    for (; *p != 'e'; ++p) {
+        if (*p != '.') digits += *p;
+    }
+
+    int point = std::atoi(p + 1) + 1;
+    if (point <= 0) return "0." + std::string(-point, '0') + digits;
+    if (point >= int(digits.size())) return digits + std::string(point - digits.size(), '0');
+    return digits.substr(0, point) + "." + digits.substr(point);
+}
+
+static void run(const char* name, const std::vector<std::string>& literals) {
+    const int runs = 5;
+    double sum = 0;
+    std::printf("%s, %zu literals:\n", name, literals.size());
+    bench::report("    strtod", bench::best_of(runs, [&] {
+        for (auto& lit : literals) sum += std::strtod(lit.c_str(), nullptr);
+    }), literals.size(), "lit");
+    bench::report("    parse_f64", bench::best_of(runs, [&] {
+        for (auto& lit : literals) sum += kwik::parse_f64(lit.data(), lit.data() + lit.size());
+    }), literals.size(), "lit");
+    bench::report("    strtof", bench::best_of(runs, [&] {
+        for (auto& lit : literals) sum += std::strtof(lit.c_str(), nullptr);
+    }), literals.size(), "lit");
+    bench::report("    parse_f32", bench::best_of(runs, [&] {
+        for (auto& lit : literals) sum += kwik::parse_f32(lit.data(), lit.data() + lit.size());
+    }), literals.size(), "lit");
+    bench::keep(sum);
+}
+
+int main() {
+    const int n = 2000000;
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> magnitude(-30, 30);
+
+    std::vector<std::string> simple, f64, f32;
+    for (int i = 0; i < n; ++i) {
+        simple.push_back(std::to_string(rng() % 10000) + "." + std::to_string(rng() % 1000));
+        double d = std::pow(10.0, magnitude(rng));
+        f64.push_back(plain_decimal(d, 17));
+        f32.push_back(plain_decimal(float(d), 9));
+    }
+
+    run("short literals", simple);
+    run("17 digit literals", f64);
+    run("9 digit literals", f32);
+}
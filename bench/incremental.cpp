@@ -0,0 +1,67 @@
+// Measures single-character edits of a large generated program with
+// IncrementalParse against parsing the edited program from scratch. Each edit
+// inserts or removes a space at the start of a random line.
+//
+// Usage: bench/incremental [<lines> [<edits>]]
+//
+// Lines defaults to 100000 (about 5 MB) and edits to 200.
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include "libop/op.h"
+
+#include "incremental.h"
+#include "parser.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int num_edits = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    std::string code = bench::generate_program(lines);
+    std::vector<size_t> line_starts;
+    for (size_t i = 0; i + 1 < code.size(); ++i) {
+        if (code[i] == '\n') line_starts.push_back(i + 1);
+    }
+
+    // Skip the opening and closing brace lines.
+    line_starts.pop_back();
+
+    // An edit adds a space at the start of a line, the next one takes it away.
+    std::mt19937 rng(1);
+    std::vector<size_t> edits;
+    for (int i = 0; i < num_edits; i += 2) edits.push_back(line_starts[rng() % line_starts.size()]);
+
+    IncrementalParse inc(make_source_shared(code, "bench.kw"));
+    size_t full_parses = 0;
+    double incremental = bench::best_of(3, [&] {
+        for (size_t offset : edits) {
+            inc.edit(offset, 0, " ");
+            full_parses += inc.last_stats().full;
+            inc.edit(offset, 1, "");
+            full_parses += inc.last_stats().full;
+        }
+    });
+
+    double full = bench::best_of(3, [&] {
+        for (size_t offset : edits) {
+            code.insert(offset, 1, ' ');
+            bench::keep(parse(*make_source_shared(code, "bench.kw")).errors.size());
+            code.erase(offset, 1);
+            bench::keep(parse(*make_source_shared(code, "bench.kw")).errors.size());
+        }
+    });
+
+    size_t n = 2 * edits.size();
+    std::printf("%zu lines, %zu bytes, %zu edits\n", lines, code.size(), n);
+    std::printf("incremental %10.3f ms/edit (%zu full parses)\n", incremental * 1e3 / n, full_parses);
+    std::printf("full        %10.3f ms/edit  %5.1fx\n", full * 1e3 / n, full / incremental);
+}
@@ -0,0 +1,64 @@
+// Measures how compile_files scales with the number of threads, on generated
+// files written to a temporary directory.
+//
+// Usage: bench/jobs [<max jobs> [<files> [<lines per file>]]]
+//
+// Max jobs defaults to the hardware concurrency, files to 32 and lines to
+// 100000 (about 5 MB).
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "libop/op.h"
+
+#include "driver.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+int main(int argc, char** argv) {
+    unsigned max_jobs = argc > 1 ? std::atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    int num_files = argc > 2 ? std::atoi(argv[2]) : 32;
+    int lines = argc > 3 ? std::atoi(argv[3]) : 100000;
+
+    char dir[] = "/tmp/kwik-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        std::fprintf(stderr, "error: can't create a temporary directory\n");
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    for (int i = 0; i < num_files; ++i) {
+        files.push_back(op::format("{}/file{}.kw", dir, i));
+        std::FILE* file = std::fopen(files.back().c_str(), "w");
+        std::fputs(bench::generate_program(lines, false, i).c_str(), file);
+        std::fclose(file);
+    }
+
+    std::vector<unsigned> job_counts;
+    for (unsigned jobs = 1; jobs < max_jobs; jobs *= 2) job_counts.push_back(jobs);
+    job_counts.push_back(max_jobs);
+
+    double one_job = 0;
+    for (unsigned jobs : job_counts) {
+        DriverOptions opts;
+        opts.jobs = jobs;
+        double seconds = bench::best_of(3, [&] {
+            size_t bytes = 0;
+            compile_files(files, opts, [&](const std::string& out) { bytes += out.size(); });
+            bench::keep(bytes);
+        });
+
+        if (jobs == 1) one_job = seconds;
+        std::printf("-j%-3u %10.3f ms  %5.2fx\n", jobs, seconds * 1e3, one_job / seconds);
+    }
+
+    for (auto& file : files) unlink(file.c_str());
+    rmdir(dir);
+}
@@ -0,0 +1,79 @@
+// Compares keyword recognition by the generated perfect hash match_keyword
+// with the std::unordered_map lookup the lexer used before, on identifiers
+// drawn from keywords, near misses and ordinary names, and measures lexing
+// identifier-heavy code.
+//
+// Usage: bench/keywords [<keywords.txt>]
+//
+// The keyword list defaults to src/keywords.txt, so run it from the root of
+// the repository.
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <cstdio>
+
+#include "lexer.h"
+#include "keywords.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+int main(int argc, char** argv) {
+    const char* list = argc > 1 ? argv[1] : "src/keywords.txt";
+    std::ifstream in(list);
+    if (!in) {
+        std::fprintf(stderr, "error: can't open %s\n", list);
+        return 1;
+    }
+
+    // The old lexer mapped keywords to their token, built from the same list.
+    std::unordered_map<std::string, int> keywords;
+    std::vector<std::string> words;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string word;
+        if (line.empty() || line[0] == '#' || !(ss >> word)) continue;
+        keywords[word] = match_keyword(word.data(), word.size());
+        words.push_back(word);
+        words.push_back(word + "s");
+        words.push_back(word.substr(0, word.size() - 1));
+    }
+
+    for (auto name : {"x", "i", "value", "counter", "variable_name", "tmp", "lettuce", "ret"}) words.push_back(name);
+
+    std::mt19937 rng(1);
+    std::vector<std::string> idents;
+    for (int i = 0; i < 1000000; ++i) idents.push_back(words[rng() % words.size()]);
+
+    const int runs = 5;
+    int found = 0;
+    bench::report("unordered_map lookup", bench::best_of(runs, [&] {
+        for (auto& ident : idents) {
+            auto it = keywords.find(std::string(ident.data(), ident.size()));
+            found += it != keywords.end();
+        }
+    }), idents.size(), "ident");
+    bench::report("match_keyword", bench::best_of(runs, [&] {
+        for (auto& ident : idents) found += match_keyword(ident.data(), ident.size()) != 0;
+    }), idents.size(), "ident");
+    bench::keep(found);
+
+    // Every line of the generated program has a few identifiers, two of them
+    // keywords in most lines.
+    const Source& src = make_source(bench::generate_program(500000), "<generated>");
+    size_t num_tokens = 0;
+    double seconds = bench::best_of(runs, [&] {
+        Lexer lex{src};
+        num_tokens = 0;
+        while (lex.get_token().type != 0) ++num_tokens;
+    });
+    bench::report("lex generated program", seconds, num_tokens, "tok");
+}
@@ -0,0 +1,87 @@
+// Measures the lexer on its own, token by token with get_token and all at
+// once with lex_all. It is built twice: bench/lexer dispatches with computed
+// goto, bench/lexer_switch with the portable switch, so the two can be
+// compared on the same inputs.
+//
+// Usage: bench/lexer [<file>...]
+//
+// Without files it runs on generated programs: one of short tokens with
+// many distinct names, one of short tokens with few names and one of long
+// identifiers and comments. With many distinct names interning the names
+// takes most of the time.
+
+#include "precompile.h"
+
+#include <string>
+#include <cstdio>
+#include "libop/op.h"
+
+#include "io.h"
+#include "lexer.h"
+#include "exception.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+// Few distinct names, so interning stays in cache and dispatch dominates.
+static std::string generate_few_names(size_t lines) {
+    std::string code = "{\n";
+    for (size_t i = 0; i < lines; ++i) {
+        code += op::format("    {{ let x{} = {}; let y = (x{}) }}\n", i % 16, i % 1000, i % 16);
+    }
+
+    code += "}\n";
+    return code;
+}
+
+static std::string generate_long_tokens(size_t lines) {
+    std::string code = "{\n";
+    for (size_t i = 0; i < lines; ++i) {
+        auto name = op::format("a_rather_long_descriptive_identifier_name_number_{}", i);
+        code += op::format("    # Binds {} to the value of the line number it's on.\n", name);
+        code += op::format("    let {} = {}\n", name, i);
+    }
+
+    code += "}\n";
+    return code;
+}
+
+static void run(const Source& src) {
+    const int runs = 7;
+    size_t num_tokens = 0;
+    double seconds = bench::best_of(runs, [&] {
+        Lexer lex{src};
+        num_tokens = 0;
+        while (lex.get_token().type != 0) ++num_tokens;
+    });
+
+    std::printf("%s, %zu bytes, %zu tokens:\n", src.name.c_str(), src.code_size, num_tokens);
+    bench::report("    get_token", seconds, num_tokens, "tok");
+    bench::report("    lex_all", bench::best_of(runs, [&] {
+        TokenBuffer tokens;
+        Lexer{src}.lex_all(tokens);
+        bench::keep(tokens.size());
+    }), num_tokens, "tok");
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc > 1) {
+            for (int i = 1; i < argc; ++i) run(read_file(argv[i]));
+        } else {
+            run(make_source(bench::generate_program(500000), "short tokens, many names"));
+            run(make_source(generate_few_names(1000000), "short tokens, few names"));
+            run(make_source(generate_long_tokens(200000), "long identifiers and comments"));
+        }
+    } catch (const CompilationError& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    } catch (const EncodingError& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    } catch (const FilesystemError& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,50 @@
+// Measures whole parses, checking included, in both modes: STREAMING, which
+// lexes token by token as the parser asks for them, and PRELEXED, which lexes
+// everything into a TokenBuffer first.
+//
+// Usage: bench/parse [<file>...]
+//
+// Without files it runs on generated programs, one with ASCII comments and
+// one with mostly non-ASCII comments.
+
+#include "precompile.h"
+
+#include <string>
+#include <cstdio>
+#include "libop/op.h"
+
+#include "io.h"
+#include "parser.h"
+#include "exception.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+static void run(const Source& src) {
+    const int runs = 7;
+    std::printf("%s, %zu bytes:\n", src.name.c_str(), src.code_size);
+    for (ParseMode mode : {ParseMode::STREAMING, ParseMode::PRELEXED}) {
+        size_t num_errors = 0;
+        double seconds = bench::best_of(runs, [&] { num_errors = parse(src, mode).errors.size(); });
+        bench::report(mode == ParseMode::STREAMING ? "    streaming" : "    prelexed", seconds, src.code_size, "B");
+        if (num_errors) std::printf("    (%zu errors)\n", num_errors);
+    }
+}
+
+int main(int argc, char** argv) {
+    try {
+        if (argc > 1) {
+            for (int i = 1; i < argc; ++i) run(read_file(argv[i]));
+        } else {
+            run(make_source(bench::generate_program(300000), "ascii comments"));
+            run(make_source(bench::generate_program(300000, true), "unicode comments"));
+        }
+    } catch (const EncodingError& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    } catch (const FilesystemError& e) {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
+}
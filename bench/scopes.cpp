@@ -0,0 +1,132 @@
+// Compares the scoped symbol table the checker uses with the chain of
+// std::maps, one per block, that environments were before, on the lookups
+// and bindings of checking two programs:
+// - deep: 2000 nested blocks of 20 names each, every one initialized from
+//   the same name in the block around it, and one from the outermost block;
+// - wide: 200000 global names, then 2000 blocks that each shadow 50 of them.
+// Also measures checking those programs in full.
+//
+// Usage: bench/scopes
+
+#include "precompile.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include "libop/op.h"
+
+#include "ast.h"
+#include "parser.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+// Environments as they were: a lookup searches every enclosing scope.
+class ChainedEnvironment {
+public:
+    ChainedEnvironment() : scopes(1) { }
+
+    void enter_scope() { scopes.emplace_back(); }
+    void leave_scope() { scopes.pop_back(); }
+
+    ast::Node* lookup(Symbol name) const {
+        for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+            auto it = scope->find(name);
+            if (it != scope->end()) return it->second;
+        }
+
+        return nullptr;
+    }
+
+    bool bound_in_scope(Symbol name) const { return scopes.back().count(name); }
+    void bind(Symbol name, ast::Node* decl) { scopes.back()[name] = decl; }
+
+private:
+    std::vector<std::map<Symbol, ast::Node*>> scopes;
+};
+
+static std::string deep() {
+    const int depth = 2000, names = 20;
+    std::string code = "{\n";
+    for (int d = 0; d < depth; ++d) {
+        if (d) code += "{\n";
+        for (int i = 0; i < names; ++i) {
+            std::string name = op::format("n{}_{}", i, d);
+            std::string init = d ? op::format("n{}_{}", i, d - 1) : op::format("{}", i);
+            code += op::format("let {} = {}\n", name, init);
+        }
+
+        code += op::format("let x{} = n0_0\n", d);
+    }
+
+    for (int d = 0; d < depth; ++d) code += "}\n";
+    return code;
+}
+
+static std::string wide() {
+    const int globals = 200000, blocks = 2000, shadowed = 50;
+    std::string code = "{\n";
+    for (int i = 0; i < globals; ++i) code += op::format("let name_{} = {}\n", i, i);
+    for (int b = 0; b < blocks; ++b) {
+        code += "{ ";
+        for (int i = 0; i < shadowed; ++i) {
+            int n = (b * shadowed + i) % globals;
+            code += op::format("{}let name_{} = name_{} ", i ? "; " : "", n, n);
+        }
+
+        code += "}\n";
+    }
+
+    code += "}\n";
+    return code;
+}
+
+// Replays the bindings and lookups of checking program on an Env.
+template<class Env>
+static void replay(const ast::CompoundStmt* program) {
+    struct Replayer : ast::AstVisitor<Replayer> {
+        Env env;
+        const ast::CompoundStmt* root;
+
+        void enter_compound(ast::CompoundStmt* compound) { if (compound != root) env.enter_scope(); }
+        void leave_compound(ast::CompoundStmt* compound) { if (compound != root) env.leave_scope(); }
+        void enter_name(ast::NameExpr* name) { bench::keep(env.lookup(name->name)); }
+        void enter_let(ast::LetStmt* let) { if (env.bound_in_scope(let->name)) std::abort(); }
+        void leave_let(ast::LetStmt* let) { env.bind(let->name, let->expr); }
+    };
+
+    Replayer replayer;
+    replayer.root = program;
+    replayer.visit(const_cast<ast::CompoundStmt*>(program));
+}
+
+static void run(const char* what, const std::string& code) {
+    const int runs = 5;
+    const Source& src = make_source(code, what);
+    AstArena arena;
+    ParseResult result = parse(src, ParseMode::STREAMING, &arena);
+    if (!result.program || !result.errors.empty()) {
+        std::printf("%s: doesn't check\n", what);
+        return;
+    }
+
+    std::printf("%s:\n", what);
+    std::printf("    chained maps %10.3f ms\n", 1e3 * bench::best_of(runs, [&] {
+        replay<ChainedEnvironment>(result.program);
+    }));
+    std::printf("    scoped table %10.3f ms\n", 1e3 * bench::best_of(runs, [&] {
+        replay<ast::Environment>(result.program);
+    }));
+    std::printf("    full check   %10.3f ms\n", 1e3 * bench::best_of(runs, [&] {
+        ast::Environment env;
+        ast::check(result.program, env);
+    }));
+}
+
+int main() {
+    run("deep", deep());
+    run("wide", wide());
+}
@@ -0,0 +1,107 @@
+// Compares the latency of compiling a file with a fresh kwik process (cold)
+// against sending it to a running kwik --server with kwik --client (warm),
+// for generated files of a few sizes. Both include starting a process.
+//
+// Usage: bench/server [<kwik binary> [<runs>]]
+//
+// The binary defaults to ./kwik and runs to 20. Prints the median of the runs.
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "libop/op.h"
+
+#include "bench.h"
+
+
+static pid_t spawn(const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    for (auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    return pid;
+}
+
+static int run(const std::vector<std::string>& args) {
+    int status;
+    if (waitpid(spawn(args), &status, 0) < 0) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static double median_of(int runs, const std::vector<std::string>& args) {
+    std::vector<double> seconds;
+    for (int i = 0; i < runs; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run(args);
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(seconds.begin(), seconds.end());
+    return seconds[seconds.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    std::string kwik = argc > 1 ? argv[1] : "./kwik";
+    int runs = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    char dir[] = "/tmp/kwik-bench-XXXXXX";
+    if (!mkdtemp(dir)) {
+        std::fprintf(stderr, "error: can't create a temporary directory\n");
+        return 1;
+    }
+
+    std::string socket_path = op::format("{}/socket", dir);
+    pid_t server = spawn({kwik, "--server", socket_path});
+
+    // Wait for the server to come up.
+    std::string probe = op::format("{}/probe.kw", dir);
+    std::FILE* file = std::fopen(probe.c_str(), "w");
+    std::fputs(bench::generate_program(1).c_str(), file);
+    std::fclose(file);
+    int tries = 0;
+    while (run({kwik, "--client", socket_path, probe}) != 0) {
+        if (++tries == 100) {
+            std::fprintf(stderr, "error: %s --server didn't start\n", kwik.c_str());
+            kill(server, SIGTERM);
+            return 1;
+        }
+
+        usleep(50000);
+    }
+
+    std::printf("%8s %12s %12s\n", "lines", "cold", "warm");
+    for (int lines : {100, 10000, 100000}) {
+        std::string path = op::format("{}/file{}.kw", dir, lines);
+        file = std::fopen(path.c_str(), "w");
+        std::fputs(bench::generate_program(lines).c_str(), file);
+        std::fclose(file);
+
+        double cold = median_of(runs, {kwik, path});
+        double warm = median_of(runs, {kwik, "--client", socket_path, path});
+        std::printf("%8d %9.3f ms %9.3f ms\n", lines, cold * 1e3, warm * 1e3);
+        unlink(path.c_str());
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, nullptr, 0);
+    unlink(probe.c_str());
+    unlink(socket_path.c_str());
+    rmdir(dir);
+}
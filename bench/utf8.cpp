@@ -0,0 +1,125 @@
+// Compares the ways source code is taken in: the decoding loop make_source
+// used to run on all input, its scanning fast path, scalar and vectorized
+// UTF-8 validation on their own, and loading a file by mapping it (read_file)
+// versus reading a private copy (read_file_shared).
+//
+// Usage: bench/utf8 [<file>...]
+//
+// Without files it runs on a generated ASCII-heavy and non-ASCII-heavy corpus
+// of about 20 MB each.
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "libop/op.h"
+#include "utf8cpp/utf8.h"
+
+#include "io.h"
+#include "scan.h"
+#include "exception.h"
+#include "bench.h"
+
+using namespace kwik;
+
+
+// The checked path: decode every code point and append it again, keeping
+// track of lines and columns for diagnostics.
+static std::string decode_checked(const std::string& src) {
+    auto cbegin = src.data();
+    auto cend = src.data() + src.size();
+    if (utf8::starts_with_bom(cbegin, cend)) cbegin += 3;
+
+    utf8::iterator<decltype(cbegin)> it{cbegin, cbegin, cend};
+    utf8::iterator<decltype(cbegin)> end{cend, cbegin, cend};
+
+    std::string code; code.reserve(src.size() + Source::NULL_BYTES_APPENDED);
+    auto code_append = std::back_inserter(code);
+    int line = 1;
+    int col = 1;
+    while (it != end) {
+        auto c = *it++;
+        if (c == 0) throw FilesystemError("null character encountered");
+        if (c == '\r' || c == '\n') {
+            utf8::append('\n', code_append);
+            if (c == '\r' && it != end && *it == '\n') ++it;
+            line++; col = 1;
+        } else {
+            utf8::append(c, code_append);
+            col++;
+        }
+    }
+
+    code.append(Source::NULL_BYTES_APPENDED, '\0');
+    bench::keep(line);
+    bench::keep(col);
+    return code;
+}
+
+static void run(const std::string& name, const std::string& code) {
+    const int runs = 5;
+    double size = code.size();
+    std::printf("%s, %zu bytes:\n", name.c_str(), code.size());
+
+    auto scan = scan_utf8(code.data(), code.data() + code.size());
+    if (!scan.valid || scan.has_nul) {
+        std::printf("    not valid UTF-8 without null bytes, skipped\n");
+        return;
+    }
+
+    bench::report("    scan_utf8_scalar", bench::best_of(runs, [&] {
+        bench::keep(scan_utf8_scalar(code.data(), code.data() + code.size()));
+    }), size, "B");
+    bench::report("    scan_utf8", bench::best_of(runs, [&] {
+        bench::keep(scan_utf8(code.data(), code.data() + code.size()));
+    }), size, "B");
+    bench::report("    checked decode", bench::best_of(runs, [&] {
+        bench::keep(decode_checked(code));
+    }), size, "B");
+    bench::report("    make_source", bench::best_of(runs, [&] {
+        bench::keep(make_source(code, name).code_size);
+    }), size, "B");
+
+    char path[] = "/tmp/kwik-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, code.data(), code.size()) != ssize_t(code.size())) {
+        std::printf("    can't write %s, skipped loading\n", path);
+        return;
+    }
+
+    close(fd);
+    bench::report("    read_file (mapped)", bench::best_of(runs, [&] {
+        bench::keep(read_file(path).code_size);
+    }), size, "B");
+    bench::report("    read_file_shared", bench::best_of(runs, [&] {
+        bench::keep(read_file_shared(path, name)->code_size);
+    }), size, "B");
+    unlink(path);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) {
+            std::FILE* file = std::fopen(argv[i], "rb");
+            if (!file) {
+                std::fprintf(stderr, "error: can't open %s\n", argv[i]);
+                return 1;
+            }
+
+            std::string code;
+            char buf[1 << 16];
+            size_t n;
+            while ((n = std::fread(buf, 1, sizeof(buf), file))) code.append(buf, n);
+            std::fclose(file);
+            run(argv[i], code);
+        }
+
+        return 0;
+    }
+
+    run("ASCII-heavy", bench::generate_program(500000));
+    run("non-ASCII-heavy", bench::generate_program(400000, true));
+}
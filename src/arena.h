@@ -0,0 +1,92 @@
+#ifndef KWIK_ARENA_H
+#define KWIK_ARENA_H
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace kwik {
+    // A contiguous array allocated in an arena.
+    template<class T>
+    struct ArenaArray {
+        T* data;
+        size_t size;
+
+        T* begin() const { return data; }
+        T* end() const { return data + size; }
+        T& operator[](size_t i) const { return data[i]; }
+    };
+
+    // Bump pointer allocator for AST nodes. Everything is freed at once when
+    // the arena is destroyed or reset, the destructors of allocated objects
+    // never run.
+    class AstArena {
+    public:
+        AstArena() : next_block(0), pos(nullptr), left(0), next_block_size(MIN_BLOCK_SIZE) { }
+        AstArena(const AstArena&) = delete;
+        AstArena& operator=(const AstArena&) = delete;
+
+        void* allocate(size_t size, size_t align) {
+            size_t pad = -reinterpret_cast<uintptr_t>(pos) & (align - 1);
+            if (pad + size > left) return allocate_slow(size, align);
+            char* result = pos + pad;
+            pos += pad + size;
+            left -= pad + size;
+            return result;
+        }
+
+        template<class T, class... Args>
+        T* make(Args&&... args) {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        template<class T>
+        ArenaArray<T> make_array(size_t size) {
+            return {static_cast<T*>(allocate(size * sizeof(T), alignof(T))), size};
+        }
+
+        // Frees everything at once but keeps the blocks for reuse.
+        void reset() {
+            next_block = 0;
+            pos = nullptr;
+            left = 0;
+        }
+
+    private:
+        static constexpr size_t MIN_BLOCK_SIZE = 4096;
+        static constexpr size_t MAX_BLOCK_SIZE = 1 << 20;
+
+        struct Block {
+            std::unique_ptr<char[]> data;
+            size_t size;
+        };
+
+        void* allocate_slow(size_t size, size_t align) {
+            // Reuse blocks kept by reset() before allocating new ones. Blocks
+            // come from new[] and are thus aligned for any fundamental type.
+            while (next_block < blocks.size() && blocks[next_block].size < size) ++next_block;
+            if (next_block == blocks.size()) {
+                size_t block_size = std::max(next_block_size, size);
+                blocks.push_back({std::unique_ptr<char[]>(new char[block_size]), block_size});
+                next_block_size = std::min(2 * next_block_size, size_t(MAX_BLOCK_SIZE));
+            }
+
+            Block& block = blocks[next_block++];
+            pos = block.data.get();
+            left = block.size;
+            return allocate(size, align);
+        }
+
+        std::vector<Block> blocks;
+        size_t next_block;
+        char* pos;
+        size_t left;
+        size_t next_block_size;
+    };
+}
+
+#endif
@@ -4,141 +4,404 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include "libop/op.h"
 
 #include "type.h"
 #include "token.h"
+#include "arena.h"
 
 namespace kwik {
     namespace ast {
+        enum class NodeKind : uint8_t {
+            // Expressions, keep these together.
+            NUMBER,
+            NAME,
+
+            COMPOUND,
+            LET,
+            RETURN,
+        };
+
+        // Nodes are allocated in an AstArena owned by the parse and are never
+        // destroyed individually, so they may not own any resources. They have
+        // no virtual functions, passes dispatch on the kind instead.
         struct Node {
-            Node(Token token) : token(token) { }
-            // Constructor to take ownership of token from parser.
-            Node(Token* tokptr) : token(std::move(*tokptr)) { delete tokptr; }
-            virtual const char* ast_type() = 0;
-            virtual ~Node() { }
+            Node(NodeKind kind, Token token) : kind(kind), token(token) { }
+            const char* ast_type() const;
+
+            NodeKind kind;
             Token token;
         };
+
+        // LLVM style casts, every node class has a classof(const Node*).
+        template<class T>
+        inline bool isa(const Node* node) { return T::classof(node); }
+
+        template<class T>
+        inline T* cast(Node* node) {
+            assert(isa<T>(node));
+            return static_cast<T*>(node);
+        }
+
+        template<class T>
+        inline T* dyn_cast(Node* node) { return isa<T>(node) ? static_cast<T*>(node) : nullptr; }
         
-        struct Environment {
-            Environment(Environment* parent) : parent(parent) { }
-            Environment* parent;
+        // The names in scope at some point of the program, for all enclosing
+        // scopes at once. Every name maps to its innermost binding, which
+        // links to the one it shadows. Bindings are kept in the order they
+        // were made, so leaving a scope just pops its bindings and restores
+        // what they shadowed. Names are bound to a Decl, Decl() is unbound.
+        template<class Decl>
+        class ScopedEnvironment {
+        public:
+            ScopedEnvironment() : depth(0) { }
+
+            void enter_scope() { scope_starts.push_back(bindings.size()); ++depth; }
+
+            void leave_scope() {
+                for (size_t n = scope_starts.back(); bindings.size() > n; bindings.pop_back()) {
+                    auto& binding = bindings.back();
+                    if (binding.shadowed_plus_one) innermost[binding.name] = binding.shadowed_plus_one;
+                    else innermost.erase(binding.name);
+                }
 
-            Node* lookup(const std::string& name) {
-                auto it = symbols.find(name);
-                if (it != symbols.end()) return it->second;
-                if (parent) return parent->lookup(name);
-                return nullptr;
+                scope_starts.pop_back();
+                --depth;
             }
 
-            std::map<std::string, Node*> symbols;
+            Decl lookup(Symbol name) const {
+                auto it = innermost.find(name);
+                return it != innermost.end() ? bindings[it->second - 1].decl : Decl();
+            }
+
+            bool bound_in_scope(Symbol name) const {
+                auto it = innermost.find(name);
+                return it != innermost.end() && bindings[it->second - 1].depth == depth;
+            }
+
+            void bind(Symbol name, Decl decl) {
+                uint32_t& top_plus_one = innermost[name];
+                bindings.push_back({name, decl, depth, top_plus_one});
+                top_plus_one = bindings.size();
+            }
+
+        private:
+            struct Binding {
+                Symbol name;
+                Decl decl;
+                uint32_t depth;
+                uint32_t shadowed_plus_one; // 0 if none.
+            };
+
+            // Indices are stored plus one, as in the symbol table.
+            std::unordered_map<Symbol, uint32_t> innermost;
+            std::vector<Binding> bindings;
+            std::vector<size_t> scope_starts;
+            uint32_t depth;
         };
 
+        using Environment = ScopedEnvironment<Node*>;
+
+        inline Type number_type(const Token::Number& number) {
+            if (number.floating) {
+                return number.suffix == NumSuffix::F32 ? kwik::Type::F32 : kwik::Type::F64;
+            }
+
+            // TODO: support more integer types.
+            assert(number.suffix == NumSuffix::NONE || number.suffix == NumSuffix::I64);
+            return kwik::Type::I64;
+        }
+
         struct Stmt : Node {
-            Stmt(Token token) : Node(std::move(token)) { }
-            Stmt(Token* tokptr) : Node(tokptr) { }
-            virtual void check(Environment& env) { }
+            Stmt(NodeKind kind, Token token) : Node(kind, token), next(nullptr) { }
+            static bool classof(const Node* node) { return true; }
+
+            // Links statements while their list is being parsed.
+            Stmt* next;
+        };
+
+        struct StmtList {
+            Stmt* first;
+            Stmt* last;
+            size_t size;
         };
 
         struct Expr : Stmt {
-            Expr(Token token) : Stmt(std::move(token)) { }
-            Expr(Token* tokptr) : Stmt(tokptr) { }
-            virtual Type type(Environment& env) = 0;
+            Expr(NodeKind kind, Token token) : Stmt(kind, token), cached_type(Type::UNKNOWN) { }
+            static bool classof(const Node* node) { return node->kind <= NodeKind::NAME; }
+
+            // Names in the expression must have been resolved by check().
+            Type type();
+
+            // Set by type(), UNKNOWN until then.
+            Type cached_type;
         };
 
         struct NumberExpr : Expr {
-            NumberExpr(Token* tokptr) : Expr(tokptr) { }
-            const char* ast_type() override { return "Number"; }
+            NumberExpr(Token token) : Expr(NodeKind::NUMBER, token) { }
+            static bool classof(const Node* node) { return node->kind == NodeKind::NUMBER; }
 
-            Type type(Environment& env) override {
-                // TODO: support more types.
-                assert(!token.number.floating);
-                assert(!token.number.suffix_len || token.val.substr(token.val.size() - token.number.suffix_len) == "i64");
-                return kwik::Type::I64;
-            }
+            Type number_type() const { return ast::number_type(token.number); }
         };
 
         struct NameExpr : Expr {
-            NameExpr(Token* tokptr) : Expr(tokptr) { }
-            const char* ast_type() override { return "Name"; }
-
-            void check(Environment& env) override { val(env); }
+            NameExpr(Token token) : Expr(NodeKind::NAME, token), name(token.sym), decl(nullptr), target(nullptr) { }
+            static bool classof(const Node* node) { return node->kind == NodeKind::NAME; }
 
-            Expr* val(Environment& env) {
-                auto node = env.lookup(token.val);
+            // Resolves the name in env. Names are resolved again on every
+            // check, as an edit may have changed what they're bound to.
+            void resolve(Environment& env) {
+                auto node = env.lookup(name);
                 if (!node) {
-                    throw SemanticError(op::format("undefined name '{}'", token.val), token.ref);
+                    throw SemanticError(op::format("undefined name '{}'", symbols().str(name)), token.loc);
                 }
 
-                Expr* expr = dynamic_cast<Expr*>(node);
-                if (!expr) {
-                    throw SemanticError(op::format("'{}' is not an expression", token.val), token.ref);
+                decl = dyn_cast<Expr>(node);
+                if (!decl) {
+                    throw SemanticError(op::format("'{}' is not an expression", symbols().str(name)), token.loc);
                 }
 
-                return expr;
-            }
-            
-            Type type(Environment& env) override {
-                return val(env)->type(env);
+                auto name_decl = dyn_cast<NameExpr>(decl);
+                target = name_decl ? name_decl->target : decl;
+                cached_type = Type::UNKNOWN;
             }
+
+            Symbol name;
+
+            // The expression the name is bound to, and the first expression
+            // that isn't a name along the chain of aliases starting there.
+            Expr* decl;
+            Expr* target;
         };
 
         struct CompoundStmt : Stmt {
-            CompoundStmt(Token* tokptr, std::vector<std::unique_ptr<Stmt>> stmt_list)
-                : Stmt(tokptr), stmt_list(std::move(stmt_list)) { }
-            CompoundStmt(Token* tokptr) : Stmt(tokptr), stmt_list() { }
-            const char* ast_type() override { return "CompoundStmt"; }
-
-            void check(Environment& env) {
-                for (auto& stmt : stmt_list) {
-                    auto compound_stmt = dynamic_cast<CompoundStmt*>(stmt.get());
-                    if (compound_stmt) {
-                        Environment new_env(&env);
-                        compound_stmt->check(new_env);
-                    } else stmt->check(env);
+            CompoundStmt(Token token, StmtList list, AstArena& arena)
+                : Stmt(NodeKind::COMPOUND, token), stmt_list(arena.make_array<Stmt*>(list.size)) {
+                Stmt* stmt = list.first;
+                for (auto& slot : stmt_list) {
+                    slot = stmt;
+                    stmt = stmt->next;
                 }
             }
+            CompoundStmt(Token token) : Stmt(NodeKind::COMPOUND, token), stmt_list{nullptr, 0} { }
+            static bool classof(const Node* node) { return node->kind == NodeKind::COMPOUND; }
 
-            std::vector<std::unique_ptr<Stmt>> stmt_list;
+            ArenaArray<Stmt*> stmt_list;
         };
 
 
         struct LetStmt : Stmt {
-            LetStmt(Token* tokptr, const std::string& name, const std::string& typedecl, Expr* expr)
-            : Stmt(tokptr), name(name), typedecl(typedecl), expr(expr) { }
-            const char* ast_type() override { return "LetStmt"; }
+            LetStmt(Token token, Symbol name, Expr* expr)
+            : Stmt(NodeKind::LET, token), name(name), has_typedecl(false), typedecl(), expr(expr) { }
+            LetStmt(Token token, Symbol name, Symbol typedecl, Expr* expr)
+            : Stmt(NodeKind::LET, token), name(name), has_typedecl(true), typedecl(typedecl), expr(expr) { }
+            static bool classof(const Node* node) { return node->kind == NodeKind::LET; }
 
-            void check(Environment& env) {
-                if (env.symbols.find(name) != env.symbols.end()) {
-                    throw SemanticError("name defined multiple times in same scope", token.ref);
-                }
+            Symbol name;
+            bool has_typedecl;
+            Symbol typedecl;
+            Expr* expr;
+        };
+
+        struct ReturnStmt : Stmt {
+            ReturnStmt(Token token, Expr* expr) : Stmt(NodeKind::RETURN, token), expr(expr) { }
+            static bool classof(const Node* node) { return node->kind == NodeKind::RETURN; }
+
+            Expr* expr;
+        };
+
+
+        inline const char* Node::ast_type() const {
+            switch (kind) {
+            case NodeKind::NUMBER: return "Number";
+            case NodeKind::NAME: return "Name";
+            case NodeKind::COMPOUND: return "CompoundStmt";
+            case NodeKind::LET: return "LetStmt";
+            case NodeKind::RETURN: return "ReturnStmt";
+            }
+
+            throw InternalCompilerError("ast_type unexpected node kind");
+        }
+
+        inline Type Expr::type() {
+            if (cached_type == Type::UNKNOWN) {
+                if (auto name = dyn_cast<NameExpr>(this)) {
+                    if (!name->target) throw InternalCompilerError("type of unresolved name");
+                    cached_type = name->target->type();
+                } else cached_type = cast<NumberExpr>(this)->number_type();
+            }
+
+            return cached_type;
+        }
 
-                expr->check(env);
-                if (typedecl.size()) {
-                    auto expr_type = type_name(expr->type(env));
-                    if (expr_type != typedecl) {
-                        throw SemanticError(op::format("wrong type, '{}' != '{}'", expr_type, typedecl), token.ref);
+
+        // Walks a tree with an explicit stack rather than by recursion, so the
+        // depth of nesting is only limited by memory. Calls enter_number(
+        // NumberExpr*) and so on of Derived by the kind of a node before its
+        // children and leave_number(NumberExpr*) and so on after them, without
+        // virtual calls. The defaults do nothing, so a pass only defines what it
+        // cares about. A pass that does the same for every node defines
+        // enter(Node*) or leave(Node*) instead.
+        template<class Derived>
+        class AstVisitor {
+        public:
+            void visit(Node* root) {
+                // The stack holds the nodes entered but not left with their
+                // children still to visit. Leaves never go on it. A pass that
+                // threw may have left some behind.
+                stack.clear();
+                descend(root);
+                while (!stack.empty()) {
+                    Pending& top = stack.back();
+                    if (top.only) {
+                        Node* child = top.only;
+                        top.only = nullptr;
+                        descend(child);
+                    } else if (top.next != top.end) {
+                        descend(*top.next++);
+                    } else {
+                        Node* node = top.node;
+                        stack.pop_back();
+                        derived().leave(node);
                     }
                 }
+            }
+
+            void enter(Node* node) {
+                switch (node->kind) {
+                case NodeKind::NUMBER: return derived().enter_number(static_cast<NumberExpr*>(node));
+                case NodeKind::NAME: return derived().enter_name(static_cast<NameExpr*>(node));
+                case NodeKind::COMPOUND: return derived().enter_compound(static_cast<CompoundStmt*>(node));
+                case NodeKind::LET: return derived().enter_let(static_cast<LetStmt*>(node));
+                case NodeKind::RETURN: return derived().enter_return(static_cast<ReturnStmt*>(node));
+                }
+
+                throw InternalCompilerError("AstVisitor unexpected node kind");
+            }
+
+            void leave(Node* node) {
+                switch (node->kind) {
+                case NodeKind::NUMBER: return derived().leave_number(static_cast<NumberExpr*>(node));
+                case NodeKind::NAME: return derived().leave_name(static_cast<NameExpr*>(node));
+                case NodeKind::COMPOUND: return derived().leave_compound(static_cast<CompoundStmt*>(node));
+                case NodeKind::LET: return derived().leave_let(static_cast<LetStmt*>(node));
+                case NodeKind::RETURN: return derived().leave_return(static_cast<ReturnStmt*>(node));
+                }
 
-                env.symbols[name] = expr.get();
+                throw InternalCompilerError("AstVisitor unexpected node kind");
             }
 
-            std::string name;
-            std::string typedecl;
-            std::unique_ptr<Expr> expr;
+            void enter_number(NumberExpr* number) { }
+            void enter_name(NameExpr* name) { }
+            void enter_compound(CompoundStmt* compound) { }
+            void enter_let(LetStmt* let) { }
+            void enter_return(ReturnStmt* ret) { }
+            void leave_number(NumberExpr* number) { }
+            void leave_name(NameExpr* name) { }
+            void leave_compound(CompoundStmt* compound) { }
+            void leave_let(LetStmt* let) { }
+            void leave_return(ReturnStmt* ret) { }
+
+        private:
+            // A node with either a list of children or an only child left.
+            struct Pending {
+                Node* node;
+                Stmt* const* next;
+                Stmt* const* end;
+                Node* only;
+            };
+
+            // Enters node, and leaves it right away if it has no children.
+            void descend(Node* node) {
+                derived().enter(node);
+                Pending pending = {node, nullptr, nullptr, nullptr};
+                switch (node->kind) {
+                case NodeKind::COMPOUND: {
+                    auto& list = static_cast<CompoundStmt*>(node)->stmt_list;
+                    pending.next = list.begin();
+                    pending.end = list.end();
+                    break;
+                }
+
+                case NodeKind::LET: pending.only = static_cast<LetStmt*>(node)->expr; break;
+                case NodeKind::RETURN: pending.only = static_cast<ReturnStmt*>(node)->expr; break;
+                case NodeKind::NUMBER: case NodeKind::NAME: derived().leave(node); return;
+                }
+
+                // An only child that is a leaf is common enough to skip the stack.
+                if (pending.only && is_leaf(pending.only)) {
+                    descend(pending.only);
+                    derived().leave(node);
+                } else stack.push_back(pending);
+            }
+
+            static bool is_leaf(const Node* node) {
+                return node->kind == NodeKind::NUMBER || node->kind == NodeKind::NAME;
+            }
+
+            Derived& derived() { return static_cast<Derived&>(*this); }
+
+            // Kept between walks to reuse its memory.
+            std::vector<Pending> stack;
         };
-        
-        struct ReturnStmt : Stmt {
-            ReturnStmt(Token* tokptr, Expr* expr) : Stmt(tokptr), expr(expr) { }
-            const char* ast_type() override { return "ReturnStmt"; }
 
-            void check(Environment& env) {
-                expr->check(env);
+        // Checks that a let declared to be of type typedecl binds a value of
+        // type actual.
+        inline void check_typedecl(Type actual, Symbol typedecl, SourceLoc loc) {
+            auto expr_type = type_name(actual);
+            auto decl_type = symbols().str(typedecl);
+            if (expr_type != decl_type) {
+                throw SemanticError(op::format("wrong type, '{}' != '{}'", expr_type, decl_type), loc);
             }
+        }
+
+        // Resolves names and checks types. Throws SemanticError at the first
+        // error found.
+        class Checker : public AstVisitor<Checker> {
+        public:
+            explicit Checker(Environment& env) : env(env), root(nullptr) { }
+
+            void check(CompoundStmt* program) {
+                root = program;
+                visit(program);
+            }
+
+            void enter_name(NameExpr* name) { name->resolve(env); }
 
-            std::unique_ptr<Expr> expr;
+            // The program itself is the global scope.
+            void enter_compound(CompoundStmt* compound) { if (compound != root) env.enter_scope(); }
+            void leave_compound(CompoundStmt* compound) { if (compound != root) env.leave_scope(); }
+
+            void enter_let(LetStmt* let) {
+                if (env.bound_in_scope(let->name)) {
+                    throw SemanticError("name defined multiple times in same scope", let->token.loc);
+                }
+            }
+
+            void leave_let(LetStmt* let) {
+                if (let->has_typedecl) check_typedecl(let->expr->type(), let->typedecl, let->token.loc);
+                env.bind(let->name, let->expr);
+            }
+
+        private:
+            Environment& env;
+            CompoundStmt* root;
         };
+
+        inline void check(CompoundStmt* program, Environment& env) { Checker(env).check(program); }
+
+        // Moves the locations of a subtree by delta, for reusing it after an
+        // edit earlier in the source.
+        inline void relocate(Node* node, int32_t delta) {
+            struct Relocator : AstVisitor<Relocator> {
+                explicit Relocator(int32_t delta) : delta(delta) { }
+                void enter(Node* node) { node->token.loc.offset += delta; }
+                int32_t delta;
+            };
+
+            Relocator(delta).visit(node);
+        }
     }
 }
 
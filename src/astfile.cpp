@@ -0,0 +1,335 @@
+#include "precompile.h"
+
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "libop/op.h"
+
+#include "astfile.h"
+#include "exception.h"
+#include "grammar.h"
+
+
+namespace kwik {
+    constexpr uint8_t AstRecord::FLOATING;
+    constexpr uint8_t AstRecord::HAS_TYPEDECL;
+
+    class AstWriter : public ast::AstVisitor<AstWriter> {
+    public:
+        explicit AstWriter(const Source& src) : src(src) { }
+
+        // Records are written as nodes are left, so children come before their
+        // parent. The indices of finished subtrees wait on a stack for it.
+        void leave(ast::Node* node) {
+            AstRecord rec;
+            std::memset(&rec, 0, sizeof(rec));
+            rec.token_type = node->token.type;
+            rec.offset = src.offset(node->token.loc);
+            rec.len = node->token.len;
+
+            switch (node->kind) {
+            case ast::NodeKind::NUMBER: {
+                auto& num = node->token.number;
+                rec.kind = AstRecordKind::NUMBER;
+                rec.flags = num.floating ? AstRecord::FLOATING : 0;
+                rec.suffix = uint8_t(num.suffix);
+                rec.a = uint32_t(num.value);
+                rec.b = uint32_t(num.value >> 32);
+                rec.c = num.base;
+                break;
+            }
+
+            case ast::NodeKind::NAME:
+                rec.kind = AstRecordKind::NAME;
+                rec.a = name_index(ast::cast<ast::NameExpr>(node)->name);
+                break;
+
+            case ast::NodeKind::COMPOUND: {
+                // Our children are on top of the stack, in order.
+                rec.kind = AstRecordKind::COMPOUND;
+                rec.a = children.size();
+                rec.b = ast::cast<ast::CompoundStmt>(node)->stmt_list.size;
+                children.insert(children.end(), written.end() - rec.b, written.end());
+                written.resize(written.size() - rec.b);
+                break;
+            }
+
+            case ast::NodeKind::LET: {
+                auto let = ast::cast<ast::LetStmt>(node);
+                rec.kind = AstRecordKind::LET;
+                rec.flags = let->has_typedecl ? AstRecord::HAS_TYPEDECL : 0;
+                rec.a = name_index(let->name);
+                rec.b = let->has_typedecl ? name_index(let->typedecl) : 0;
+                rec.c = pop_written();
+                break;
+            }
+
+            case ast::NodeKind::RETURN:
+                rec.kind = AstRecordKind::RETURN;
+                rec.a = pop_written();
+                break;
+            }
+
+            nodes.push_back(rec);
+            written.push_back(nodes.size() - 1);
+        }
+
+        // Takes the index of the last finished subtree's record.
+        uint32_t pop_written() {
+            uint32_t i = written.back();
+            written.pop_back();
+            return i;
+        }
+
+        std::string finish(uint32_t root) {
+            AstFileHeader header;
+            header.magic = AST_FILE_MAGIC;
+            header.version = AST_FILE_VERSION;
+            header.code_size = src.code_size;
+            header.root = root;
+            header.num_nodes = nodes.size();
+            header.nodes_offset = sizeof(header);
+            header.num_children = children.size();
+            header.children_offset = header.nodes_offset + nodes.size() * sizeof(AstRecord);
+            header.num_names = name_ends.size();
+            header.name_ends_offset = header.children_offset + children.size() * sizeof(uint32_t);
+            header.strings_size = strings.size();
+            header.strings_offset = header.name_ends_offset + name_ends.size() * sizeof(uint32_t);
+
+            std::string data;
+            data.reserve(header.strings_offset + strings.size());
+            append(data, &header, sizeof(header));
+            append(data, nodes.data(), nodes.size() * sizeof(AstRecord));
+            append(data, children.data(), children.size() * sizeof(uint32_t));
+            append(data, name_ends.data(), name_ends.size() * sizeof(uint32_t));
+            data += strings;
+            return data;
+        }
+
+    private:
+        static void append(std::string& data, const void* p, size_t size) {
+            data.append(static_cast<const char*>(p), size);
+        }
+
+        uint32_t name_index(Symbol sym) {
+            auto it = names.find(sym);
+            if (it != names.end()) return it->second;
+
+            strings.append(symbols().data(sym), symbols().size(sym));
+            name_ends.push_back(strings.size());
+            names[sym] = name_ends.size() - 1;
+            return name_ends.size() - 1;
+        }
+
+        const Source& src;
+        std::vector<AstRecord> nodes;
+        std::vector<uint32_t> written;
+        std::vector<uint32_t> children;
+        std::vector<uint32_t> name_ends;
+        std::string strings;
+        std::unordered_map<Symbol, uint32_t> names;
+    };
+
+    std::string write_ast(ast::CompoundStmt* program, const Source& src) {
+        AstWriter writer(src);
+        writer.visit(program);
+        return writer.finish(writer.pop_written());
+    }
+
+
+    static FilesystemError invalid_ast(const char* why) {
+        return FilesystemError(op::format("invalid AST file: {}", why));
+    }
+
+    // Checks that count elements of elem_size at offset fit in size bytes.
+    static bool fits(uint64_t offset, uint64_t count, uint64_t elem_size, size_t size) {
+        return offset % 4 == 0 && offset + count * elem_size <= size;
+    }
+
+    AstView::AstView(const char* data, size_t size) {
+        if (reinterpret_cast<uintptr_t>(data) % alignof(AstFileHeader)) throw invalid_ast("misaligned");
+        if (size < sizeof(AstFileHeader)) throw invalid_ast("truncated header");
+
+        header = reinterpret_cast<const AstFileHeader*>(data);
+        if (header->magic != AST_FILE_MAGIC) throw invalid_ast("bad magic");
+        if (header->version != AST_FILE_VERSION) throw invalid_ast("unsupported version");
+        if (!fits(header->nodes_offset, header->num_nodes, sizeof(AstRecord), size) ||
+            !fits(header->children_offset, header->num_children, sizeof(uint32_t), size) ||
+            !fits(header->name_ends_offset, header->num_names, sizeof(uint32_t), size) ||
+            uint64_t(header->strings_offset) + header->strings_size > size) {
+            throw invalid_ast("section out of bounds");
+        }
+
+        nodes = reinterpret_cast<const AstRecord*>(data + header->nodes_offset);
+        children = reinterpret_cast<const uint32_t*>(data + header->children_offset);
+        name_ends = reinterpret_cast<const uint32_t*>(data + header->name_ends_offset);
+        strings = data + header->strings_offset;
+
+        for (uint32_t i = 0, prev = 0; i < header->num_names; prev = name_ends[i++]) {
+            if (name_ends[i] <= prev || name_ends[i] > header->strings_size) throw invalid_ast("bad name");
+        }
+
+        // Every node but the root must have exactly one parent that comes after
+        // it, so the nodes form a tree and walking it takes linear time.
+        std::vector<bool> has_parent(header->num_nodes);
+        auto child_ok = [&](uint32_t child, uint32_t parent) {
+            if (child >= parent || has_parent[child]) return false;
+            has_parent[child] = true;
+            return true;
+        };
+
+        // The expressions of lets and returns must be expression records.
+        auto expr_ok = [&](uint32_t child, uint32_t parent) {
+            return child_ok(child, parent) &&
+                   (nodes[child].kind == AstRecordKind::NUMBER || nodes[child].kind == AstRecordKind::NAME);
+        };
+
+        for (uint32_t i = 0; i < header->num_nodes; ++i) {
+            const AstRecord& rec = nodes[i];
+            if (uint64_t(rec.offset) + rec.len > header->code_size) throw invalid_ast("location out of bounds");
+
+            // The token of a node is always the one the grammar builds it from.
+            bool ok;
+            switch (rec.kind) {
+            case AstRecordKind::NUMBER:
+                ok = rec.token_type == KWIK_TOK_NUM && rec.suffix <= uint8_t(NumSuffix::F64);
+                break;
+            case AstRecordKind::NAME: ok = rec.token_type == KWIK_TOK_NAME && rec.a < header->num_names; break;
+            case AstRecordKind::COMPOUND:
+                ok = rec.token_type == KWIK_TOK_OPEN_BRACE && uint64_t(rec.a) + rec.b <= header->num_children;
+                for (uint32_t j = 0; ok && j < rec.b; ++j) ok = child_ok(children[rec.a + j], i);
+                break;
+            case AstRecordKind::LET:
+                ok = rec.token_type == KWIK_TOK_LET && rec.a < header->num_names && expr_ok(rec.c, i) &&
+                     (!(rec.flags & AstRecord::HAS_TYPEDECL) || rec.b < header->num_names);
+                break;
+            case AstRecordKind::RETURN: ok = rec.token_type == KWIK_TOK_RETURN && expr_ok(rec.a, i); break;
+            default: ok = false;
+            }
+
+            if (!ok) throw invalid_ast("bad node");
+        }
+
+        if (header->num_nodes == 0 || header->root != header->num_nodes - 1 ||
+            nodes[header->root].kind != AstRecordKind::COMPOUND) {
+            throw invalid_ast("bad root");
+        }
+
+        if (std::count(has_parent.begin(), has_parent.end(), false) != 1) throw invalid_ast("unreachable node");
+    }
+
+
+    static std::shared_ptr<const char> map_ast_file(const std::string& filename, size_t& size) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw FilesystemError(std::strerror(errno));
+        OP_SCOPE_EXIT { close(fd); };
+
+        struct stat st;
+        if (fstat(fd, &st) < 0) throw FilesystemError(std::strerror(errno));
+        if (!S_ISREG(st.st_mode) || st.st_size == 0) throw invalid_ast("not a regular non-empty file");
+
+        size = st.st_size;
+        void* region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (region == MAP_FAILED) throw FilesystemError(std::strerror(errno));
+
+        size_t total = size;
+        return std::shared_ptr<const char>(static_cast<const char*>(region),
+                                           [total](const char* p) { munmap((void*) p, total); });
+    }
+
+    MappedAst::MappedAst(const std::string& filename)
+        : mapped_size(0), mapping(map_ast_file(filename, mapped_size)), ast_view(mapping.get(), mapped_size) { }
+
+
+    class AstBuilder {
+    public:
+        AstBuilder(const AstView& view, const Source& src, AstArena& arena)
+            : view(view), src(src), arena(arena), syms(view.num_names()) {
+            for (uint32_t i = 0; i < syms.size(); ++i) {
+                syms[i] = symbols().intern(view.name_data(i), view.name_size(i));
+            }
+        }
+
+        // Children come before their parent, so building the records in order
+        // always finds the children of a node built already.
+        ast::CompoundStmt* build() {
+            built.resize(view.num_nodes());
+            for (uint32_t i = 0; i < built.size(); ++i) built[i] = build(i);
+            return static_cast<ast::CompoundStmt*>(built[view.root()]);
+        }
+
+    private:
+        ast::Stmt* build(uint32_t i) {
+            const AstRecord& rec = view.node(i);
+            Token token;
+            token.type = rec.token_type;
+            token.loc = src.loc(rec.offset);
+            token.len = rec.len;
+
+            switch (rec.kind) {
+            case AstRecordKind::NUMBER:
+                token.number.value = uint64_t(rec.b) << 32 | rec.a;
+                token.number.base = rec.c;
+                token.number.floating = rec.flags & AstRecord::FLOATING;
+                token.number.suffix = NumSuffix(rec.suffix);
+                return arena.make<ast::NumberExpr>(token);
+
+            case AstRecordKind::NAME:
+                token.sym = syms[rec.a];
+                return arena.make<ast::NameExpr>(token);
+
+            case AstRecordKind::COMPOUND: {
+                if (!rec.b) return arena.make<ast::CompoundStmt>(token);
+
+                ast::StmtList list = {nullptr, nullptr, 0};
+                for (auto child = view.children_begin(rec); child != view.children_end(rec); ++child) {
+                    ast::Stmt* stmt = built[*child];
+                    if (list.last) list.last->next = stmt;
+                    else list.first = stmt;
+                    list.last = stmt;
+                    ++list.size;
+                }
+
+                return arena.make<ast::CompoundStmt>(token, list, arena);
+            }
+
+            case AstRecordKind::LET: {
+                auto expr = build_expr(rec.c);
+                if (rec.flags & AstRecord::HAS_TYPEDECL) {
+                    return arena.make<ast::LetStmt>(token, syms[rec.a], syms[rec.b], expr);
+                }
+
+                return arena.make<ast::LetStmt>(token, syms[rec.a], expr);
+            }
+
+            case AstRecordKind::RETURN:
+                return arena.make<ast::ReturnStmt>(token, build_expr(rec.a));
+            }
+
+            throw InternalCompilerError("materialize_ast unexpected record");
+        }
+
+        // The view checked that these are expression records.
+        ast::Expr* build_expr(uint32_t i) { return ast::cast<ast::Expr>(built[i]); }
+
+        const AstView& view;
+        const Source& src;
+        AstArena& arena;
+        std::vector<Symbol> syms;
+        std::vector<ast::Stmt*> built;
+    };
+
+    ast::CompoundStmt* materialize_ast(const AstView& view, const Source& src, AstArena& arena) {
+        if (view.code_size() != src.code_size) {
+            throw InternalCompilerError("materializing AST for a different source");
+        }
+
+        return AstBuilder(view, src, arena).build();
+    }
+}
@@ -0,0 +1,125 @@
+#ifndef KWIK_ASTFILE_H
+#define KWIK_ASTFILE_H
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "ast.h"
+#include "arena.h"
+#include "io.h"
+
+
+// A compact binary format for parsed programs. A file holds fixed-size node
+// records, the child lists of compound statements and the names used, all
+// addressed by 32-bit indices relative to the file, so it can be mapped
+// anywhere and walked in place. Locations are offsets into the source the
+// program was parsed from, which the file doesn't contain.
+//
+// Children always come before their parent, the root last. The format is in
+// native byte order, the magic doesn't match on a host of the other order.
+namespace kwik {
+    enum class AstRecordKind : uint8_t {
+        NUMBER,
+        NAME,
+        COMPOUND,
+        LET,
+        RETURN,
+    };
+
+    struct AstRecord {
+        AstRecordKind kind;
+        uint8_t token_type;
+        uint8_t flags;
+        uint8_t suffix; // NumSuffix of numbers.
+        uint32_t offset;
+        uint32_t len;
+
+        // NUMBER: the value (low, high) and base.
+        // NAME: the name.
+        // COMPOUND: index of the first child in the child lists, count.
+        // LET: the name, the type name if HAS_TYPEDECL, the expression.
+        // RETURN: the expression.
+        uint32_t a;
+        uint32_t b;
+        uint32_t c;
+
+        static constexpr uint8_t FLOATING = 1;
+        static constexpr uint8_t HAS_TYPEDECL = 2;
+    };
+
+    // Bump the version whenever the layout or meaning of anything changes.
+    constexpr uint32_t AST_FILE_MAGIC = 0x3141574b; // "KWA1" in little endian.
+    constexpr uint32_t AST_FILE_VERSION = 1;
+
+    struct AstFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t code_size;
+        uint32_t root;
+        uint32_t num_nodes;
+        uint32_t nodes_offset;
+        uint32_t num_children;
+        uint32_t children_offset;
+
+        // Name i is [ends[i - 1], ends[i]) in the strings, with ends[-1] = 0.
+        // Names are never empty.
+        uint32_t num_names;
+        uint32_t name_ends_offset;
+        uint32_t strings_size;
+        uint32_t strings_offset;
+    };
+
+    // Serializes the program parsed from src.
+    std::string write_ast(ast::CompoundStmt* program, const Source& src);
+
+    // Walks a serialized program without copying it. The constructor checks
+    // every index, and that the records fit together as the parser would
+    // build them, so the accessors and materialize_ast don't have to.
+    class AstView {
+    public:
+        // Throws FilesystemError if data isn't a valid AST file. data must
+        // stay valid and be suitably aligned for AstFileHeader.
+        AstView(const char* data, size_t size);
+
+        uint32_t code_size() const { return header->code_size; }
+        uint32_t root() const { return header->root; }
+        size_t num_nodes() const { return header->num_nodes; }
+        const AstRecord& node(uint32_t i) const { return nodes[i]; }
+
+        // The children of a COMPOUND record.
+        const uint32_t* children_begin(const AstRecord& node) const { return children + node.a; }
+        const uint32_t* children_end(const AstRecord& node) const { return children + node.a + node.b; }
+
+        size_t num_names() const { return header->num_names; }
+        const char* name_data(uint32_t name) const { return strings + (name ? name_ends[name - 1] : 0); }
+        size_t name_size(uint32_t name) const { return name_ends[name] - (name ? name_ends[name - 1] : 0); }
+
+    private:
+        const AstFileHeader* header;
+        const AstRecord* nodes;
+        const uint32_t* children;
+        const uint32_t* name_ends;
+        const char* strings;
+    };
+
+    // A read-only memory mapping of an AST file.
+    class MappedAst {
+    public:
+        // Throws FilesystemError if the file can't be mapped or isn't valid.
+        explicit MappedAst(const std::string& filename);
+
+        const AstView& view() const { return ast_view; }
+
+    private:
+        size_t mapped_size;
+        std::shared_ptr<const char> mapping;
+        AstView ast_view;
+    };
+
+    // Rebuilds the program in arena, with locations in src, which must be the
+    // source it was parsed from.
+    ast::CompoundStmt* materialize_ast(const AstView& view, const Source& src, AstArena& arena);
+}
+
+#endif
@@ -0,0 +1,292 @@
+#include "precompile.h"
+
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "libop/op.h"
+
+#include "cache.h"
+#include "hash.h"
+#include "astfile.h"
+#include "exception.h"
+
+
+// An entry is a header followed by the diagnostics, each a kind byte, the
+// offset into the source and the message, and then the program as an AST
+// file if the parse produced one, 8-byte aligned. All in native byte order.
+namespace kwik {
+    static const char ENTRY_MAGIC[4] = {'K', 'W', 'C', '2'};
+
+    struct EntryHeader {
+        char magic[4];
+        uint32_t num_errors;
+        uint64_t settings;
+        uint64_t code_size;
+        uint64_t ast_size;
+    };
+
+    enum class ErrorKind : uint8_t {
+        SYNTAX,
+        SEMANTIC,
+    };
+
+    // Temporary files left behind by killed processes are deleted once they're
+    // this old, in seconds.
+    static const time_t STALE_TEMP_AGE = 3600;
+
+    // The cache is trimmed once this fraction of its size has been stored
+    // since the last trim, by any process. Every store adds a byte per block
+    // of the entry to the journal file, which a trim empties.
+    static const uint64_t TRIM_FRACTION = 8;
+    static const uint64_t BLOCK_SIZE = 4096;
+    static const char JOURNAL_NAME[] = "/journal";
+
+    static bool read_all(const std::string& path, std::string& data) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        OP_SCOPE_EXIT { close(fd); };
+
+        char buf[1 << 14];
+        while (true) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return false;
+            if (n == 0) return true;
+            data.append(buf, n);
+        }
+    }
+
+    static bool write_all(int fd, const char* buf, size_t len) {
+        while (len) {
+            ssize_t n = write(fd, buf, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buf += n;
+            len -= n;
+        }
+
+        return true;
+    }
+
+    // A different build of the compiler might parse differently, so entries
+    // are tied to the executable itself.
+    static uint64_t compiler_hash() {
+        static const uint64_t hash = [] {
+            std::string exe;
+            if (read_all("/proc/self/exe", exe) && !exe.empty()) return hash64(exe.data(), exe.size());
+            const char* build = __DATE__ " " __TIME__;
+            return hash64(build, std::strlen(build));
+        }();
+
+        return hash;
+    }
+
+    // Results also depend on the settings of the parse.
+    static uint64_t settings_hash(uint32_t max_nesting) {
+        return hash64(&max_nesting, sizeof(max_nesting), compiler_hash());
+    }
+
+    template<class T>
+    static void append(std::string& data, const T& x) {
+        data.append(reinterpret_cast<const char*>(&x), sizeof(x));
+    }
+
+    template<class T>
+    static bool consume(const std::string& data, size_t& pos, T& x) {
+        if (data.size() - pos < sizeof(x)) return false;
+        std::memcpy(&x, data.data() + pos, sizeof(x));
+        pos += sizeof(x);
+        return true;
+    }
+
+    // Only checks that the program is where the header says it is. The
+    // program itself is only read, and validated, if it's used.
+    static bool decode_entry(const std::string& data, const Source& src, uint64_t settings,
+                             std::vector<std::unique_ptr<CompilationError>>& errors, size_t& ast_pos,
+                             size_t& ast_size) {
+        size_t pos = 0;
+        EntryHeader header;
+        if (!consume(data, pos, header) || std::memcmp(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) ||
+            header.settings != settings || header.code_size != src.code_size) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header.num_errors; ++i) {
+            ErrorKind kind;
+            uint32_t offset, len;
+            if (!consume(data, pos, kind) || !consume(data, pos, offset) || !consume(data, pos, len)) return false;
+            if (offset > src.code_size || data.size() - pos < len) return false;
+
+            std::string msg = data.substr(pos, len);
+            pos += len;
+            if (kind == ErrorKind::SYNTAX) errors.emplace_back(new SyntaxError(std::move(msg), src.loc(offset)));
+            else if (kind == ErrorKind::SEMANTIC) errors.emplace_back(new SemanticError(std::move(msg), src.loc(offset)));
+            else return false;
+        }
+
+        ast_size = header.ast_size;
+        if (!ast_size) return pos == data.size();
+        ast_pos = (pos + 7) & ~size_t(7);
+        return ast_pos <= data.size() && data.size() - ast_pos == ast_size;
+    }
+
+
+    ParseCache::ParseCache(std::string dir, uint64_t max_bytes)
+        : dir(std::move(dir)), max_bytes(max_bytes), num_hits(0), num_misses(0) {
+        if (mkdir(this->dir.c_str(), 0755) < 0 && errno != EEXIST) {
+            throw FilesystemError(op::format("can't create cache directory {}: {}", this->dir, std::strerror(errno)));
+        }
+    }
+
+    std::string ParseCache::entry_path(const Source& src, uint64_t settings) const {
+        char name[32];
+        uint64_t key = hash64(src.code.get(), src.code_size, settings);
+        std::snprintf(name, sizeof(name), "/%016llx.kwc", static_cast<unsigned long long>(key));
+        return dir + name;
+    }
+
+    bool ParseCache::lookup(const Source& src, uint32_t max_nesting, ParseResult& result, AstArena* arena) {
+        uint64_t settings = settings_hash(max_nesting);
+        std::string path = entry_path(src, settings);
+        std::string data;
+        std::vector<std::unique_ptr<CompilationError>> errors;
+        size_t ast_pos = 0, ast_size = 0;
+        ast::CompoundStmt* program = nullptr;
+        bool ok = read_all(path, data) && decode_entry(data, src, settings, errors, ast_pos, ast_size);
+
+        // A damaged program makes the whole entry invalid.
+        if (ok && arena && ast_size) {
+            try {
+                AstView view(data.data() + ast_pos, ast_size);
+                ok = view.code_size() == src.code_size;
+                if (ok) program = materialize_ast(view, src, *arena);
+            } catch (const FilesystemError&) {
+                ok = false;
+            }
+        }
+
+        if (!ok) {
+            ++num_misses;
+            return false;
+        }
+
+        // The modification time orders entries for eviction.
+        utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+        result.errors = std::move(errors);
+        result.program = program;
+        ++num_hits;
+        return true;
+    }
+
+    void ParseCache::store(const Source& src, uint32_t max_nesting, const ParseResult& result) {
+        EntryHeader header;
+        std::memcpy(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+        header.num_errors = result.errors.size();
+        header.settings = settings_hash(max_nesting);
+        header.code_size = src.code_size;
+        std::string ast = result.program ? write_ast(result.program, src) : std::string();
+        header.ast_size = ast.size();
+
+        std::string data;
+        append(data, header);
+        for (auto& error : result.errors) {
+            // Anything we can't recreate exactly isn't cached.
+            ErrorKind kind;
+            if (dynamic_cast<const SemanticError*>(error.get())) kind = ErrorKind::SEMANTIC;
+            else if (dynamic_cast<const SyntaxError*>(error.get())) kind = ErrorKind::SYNTAX;
+            else return;
+
+            std::string msg = error->op::BaseException::what();
+            append(data, kind);
+            append(data, uint32_t(src.offset(error->loc)));
+            append(data, uint32_t(msg.size()));
+            data += msg;
+        }
+
+        if (!ast.empty()) {
+            data.resize((data.size() + 7) & ~size_t(7));
+            data += ast;
+        }
+
+        // Unique among processes by pid, among threads by counter.
+        static std::atomic<uint64_t> temp_counter{0};
+        std::string path = entry_path(src, header.settings);
+        std::string temp = op::format("{}.{}.{}.tmp", path, getpid(), temp_counter++);
+        int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) return;
+
+        bool ok = write_all(fd, data.data(), data.size());
+        ok &= close(fd) == 0;
+        if (!ok || rename(temp.c_str(), path.c_str()) < 0) {
+            unlink(temp.c_str());
+            return;
+        }
+
+        // Whoever crosses the threshold empties the journal first, so other
+        // processes don't trim at the same time.
+        fd = open((dir + JOURNAL_NAME).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) return;
+        OP_SCOPE_EXIT { close(fd); };
+
+        struct stat st;
+        std::string blocks((data.size() + BLOCK_SIZE - 1) / BLOCK_SIZE, '\0');
+        if (!write_all(fd, blocks.data(), blocks.size()) || fstat(fd, &st) < 0) return;
+        if (uint64_t(st.st_size) * BLOCK_SIZE >= max_bytes / TRIM_FRACTION && ftruncate(fd, 0) == 0) trim();
+    }
+
+    void ParseCache::trim() {
+        DIR* d = opendir(dir.c_str());
+        if (!d) return;
+        OP_SCOPE_EXIT { closedir(d); };
+
+        struct Entry {
+            std::string name;
+            struct timespec mtime;
+            uint64_t size;
+        };
+
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+        time_t now = time(nullptr);
+        while (dirent* ent = readdir(d)) {
+            std::string name = ent->d_name;
+            bool is_entry = name.size() > 4 && name.compare(name.size() - 4, 4, ".kwc") == 0;
+            bool is_temp = name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0;
+            if (!is_entry && !is_temp) continue;
+
+            struct stat st;
+            if (fstatat(dirfd(d), name.c_str(), &st, 0) < 0) continue;
+            if (is_temp) {
+                if (now - st.st_mtime > STALE_TEMP_AGE) unlinkat(dirfd(d), name.c_str(), 0);
+                continue;
+            }
+
+            // What the entry takes up on disk, which for small ones is far
+            // more than their size.
+            uint64_t size = uint64_t(st.st_blocks) * 512;
+            entries.push_back({name, st.st_mtim, size});
+            total += size;
+        }
+
+        if (total <= max_bytes) return;
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            if (a.mtime.tv_sec != b.mtime.tv_sec) return a.mtime.tv_sec < b.mtime.tv_sec;
+            return a.mtime.tv_nsec < b.mtime.tv_nsec;
+        });
+
+        // Another process may be trimming too, so entries can be gone already.
+        for (auto& entry : entries) {
+            if (total <= max_bytes) break;
+            unlinkat(dirfd(d), entry.name.c_str(), 0);
+            total -= entry.size;
+        }
+    }
+}
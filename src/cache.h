@@ -0,0 +1,49 @@
+#ifndef KWIK_CACHE_H
+#define KWIK_CACHE_H
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+#include "parser.h"
+#include "io.h"
+
+
+namespace kwik {
+    // An on-disk cache of parse results, keyed by a hash of the normalized
+    // code, the parse settings and the compiler itself, so an unchanged
+    // source is never lexed or parsed twice. Entries hold the diagnostics and
+    // the program. Entries are written to a temporary file and renamed into
+    // place, so any number of compiler processes can share a directory and
+    // never see a partial entry.
+    class ParseCache {
+    public:
+        // Creates dir if it doesn't exist. Stores trim the entries to within
+        // max_bytes of disk space now and then.
+        ParseCache(std::string dir, uint64_t max_bytes);
+
+        // Fills in the errors of result and returns true if the code of src
+        // was parsed before with the same nesting limit. As with parse, the
+        // program is only rebuilt, in arena, if an arena is given.
+        bool lookup(const Source& src, uint32_t max_nesting, ParseResult& result, AstArena* arena = nullptr);
+
+        // Stores the program too if result has one.
+        void store(const Source& src, uint32_t max_nesting, const ParseResult& result);
+
+        uint64_t hits() const { return num_hits; }
+        uint64_t misses() const { return num_misses; }
+
+    private:
+        std::string entry_path(const Source& src, uint64_t settings) const;
+
+        // Deletes the least recently used entries until the cache fits.
+        void trim();
+
+        std::string dir;
+        uint64_t max_bytes;
+        std::atomic<uint64_t> num_hits;
+        std::atomic<uint64_t> num_misses;
+    };
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "precompile.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "libop/op.h"
+
+#include "driver.h"
+#include "exception.h"
+
+
+namespace kwik {
+    // Compiles one file and returns everything it would print. Returns false in
+    // ok if compilation couldn't finish.
+    static std::string compile_file(const std::string& filename, const DriverOptions& opts, bool& ok) {
+        ok = false;
+        try {
+            ParseResult result;
+            if (opts.parse_file) {
+                result = opts.parse_file(filename);
+            } else {
+                const Source& src = opts.load ? opts.load(filename)
+                                  : filename == "-" ? read_stdin() : read_file(filename);
+
+                // The cache stores the program too, so it must outlive the parse.
+                AstArena arena;
+                if (!opts.cache || !opts.cache->lookup(src, opts.max_nesting, result)) {
+                    result = parse(src, opts.mode, opts.cache ? &arena : nullptr, opts.max_nesting);
+                    if (opts.cache) opts.cache->store(src, opts.max_nesting, result);
+                }
+            }
+
+            auto out = op::format("Finished parse with {} error(s).\n", result.errors.size());
+            for (auto& error : result.errors) {
+                out += error->what();
+                out += '\n';
+            }
+
+            ok = true;
+            return out;
+        } catch (const CompilationError& e) {
+            return std::string(e.what()) + '\n';
+        } catch (const EncodingError& e) {
+            return std::string(e.what()) + '\n';
+        } catch (const FilesystemError& e) {
+            return op::format("error: {}: {}\n", filename, e.what());
+        } catch (const InternalCompilerError& e) {
+            return op::format("internal compiler error: {}: {}\n", filename, e.what());
+        }
+    }
+
+    bool compile_files(const std::vector<std::string>& files, const DriverOptions& opts,
+                       const std::function<void(const std::string&)>& emit) {
+        bool all_ok = true;
+        if (opts.jobs <= 1 || files.size() <= 1) {
+            for (auto& file : files) {
+                bool ok;
+                emit(compile_file(file, opts, ok));
+                all_ok &= ok;
+            }
+
+            return all_ok;
+        }
+
+        struct Output {
+            std::string text;
+            bool ok;
+            bool done;
+        };
+
+        std::vector<Output> outputs(files.size(), Output{"", false, false});
+        std::atomic<size_t> next_file{0};
+        std::mutex mutex;
+        std::condition_variable file_done;
+
+        std::vector<std::thread> pool;
+        for (unsigned i = 0; i < std::min<size_t>(opts.jobs, files.size()); ++i) {
+            pool.emplace_back([&] {
+                size_t n;
+                while ((n = next_file++) < files.size()) {
+                    bool ok;
+                    auto text = compile_file(files[n], opts, ok);
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    outputs[n] = {std::move(text), ok, true};
+                    file_done.notify_one();
+                }
+            });
+        }
+
+        for (auto& output : outputs) {
+            std::unique_lock<std::mutex> lock(mutex);
+            file_done.wait(lock, [&] { return output.done; });
+            std::string text = std::move(output.text);
+            all_ok &= output.ok;
+            lock.unlock();
+
+            emit(text);
+        }
+
+        for (auto& thread : pool) thread.join();
+        return all_ok;
+    }
+}
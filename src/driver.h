@@ -0,0 +1,41 @@
+#ifndef KWIK_DRIVER_H
+#define KWIK_DRIVER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "parser.h"
+#include "cache.h"
+#include "io.h"
+
+
+namespace kwik {
+    struct DriverOptions {
+        DriverOptions()
+            : mode(ParseMode::STREAMING), jobs(1), max_nesting(DEFAULT_MAX_NESTING), cache(nullptr) { }
+
+        ParseMode mode;
+        unsigned jobs;
+        uint32_t max_nesting;
+
+        // Loads a file by the name it was given as. If empty read_file is
+        // used, or read_stdin for "-".
+        std::function<const Source&(const std::string&)> load;
+
+        // If set, this parses a file by the name it was given as instead of
+        // load, the cache and parse, for callers that keep parses of their own.
+        std::function<ParseResult(const std::string&)> parse_file;
+
+        // If set, parse results are looked up in and added to this cache.
+        ParseCache* cache;
+    };
+
+    // Compiles files on up to opts.jobs threads. The output of every file is
+    // passed to emit in the order of files, as soon as all files before it
+    // are done. Returns false if any file couldn't be compiled.
+    bool compile_files(const std::vector<std::string>& files, const DriverOptions& opts,
+                       const std::function<void(const std::string&)>& emit);
+}
+
+#endif
@@ -7,8 +7,8 @@
 
 namespace kwik {
     struct CompilationError : public virtual op::BaseException {
-        SourceRef ref;
-        CompilationError(SourceRef ref) : ref(ref), formatted_what() { }
+        SourceLoc loc;
+        CompilationError(SourceLoc loc) : loc(loc), formatted_what() { }
 
         virtual const char* error_type() const noexcept { return "compilation error"; }
         virtual CompilationError* clone() const { return new CompilationError(*this); }
@@ -26,10 +26,12 @@ namespace kwik {
         CompilationError();
 
         virtual std::string format_what() const {
+            auto& src = source_of(loc);
+            auto pos = src.line_col(loc);
             return op::format("{}:{}:{}: {}: {}\n    {}\n{}^",
-                              ref.src.name, ref.line, ref.col, this->error_type(),
+                              src.name, pos.line, pos.col, this->error_type(),
                               op::BaseException::what(), 
-                              ref.src.lines[ref.line - 1], std::string(ref.col - 1 + 4, ' '));
+                              src.line(pos.line), std::string(pos.col - 1 + 4, ' '));
         }
 
     private:
@@ -37,16 +39,16 @@ namespace kwik {
     };
 
     struct SyntaxError : public virtual CompilationError {
-        SyntaxError(std::string msg, SourceRef ref)
-            : op::BaseException(std::move(msg)), CompilationError(ref) { }
+        SyntaxError(std::string msg, SourceLoc loc)
+            : op::BaseException(std::move(msg)), CompilationError(loc) { }
         const char* error_type() const noexcept override { return "syntax error"; }
         CompilationError* clone() const override { return new SyntaxError(*this); }
     protected: SyntaxError() { }
     };
 
     struct SemanticError : public virtual CompilationError {
-        SemanticError(std::string msg, SourceRef ref)
-            : op::BaseException(std::move(msg)), CompilationError(ref) { }
+        SemanticError(std::string msg, SourceLoc loc)
+            : op::BaseException(std::move(msg)), CompilationError(loc) { }
         const char* error_type() const noexcept override { return "error"; }
         CompilationError* clone() const override { return new SemanticError(*this); }
     protected: SemanticError() { }
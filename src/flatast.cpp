@@ -0,0 +1,145 @@
+#include "precompile.h"
+
+#include "libop/op.h"
+
+#include "flatast.h"
+#include "exception.h"
+#include "grammar.h"
+
+
+namespace kwik {
+    static uint32_t skip_newlines(const TokenBuffer& tokens, uint32_t i) {
+        while (tokens.types[i] == KWIK_TOK_NL) ++i;
+        return i;
+    }
+
+    uint32_t FlatAst::let_name(const TokenBuffer& tokens, uint32_t let) {
+        return skip_newlines(tokens, let + 1);
+    }
+
+    bool FlatAst::let_has_typedecl(const TokenBuffer& tokens, uint32_t let) {
+        return tokens.types[skip_newlines(tokens, let_name(tokens, let) + 1)] == KWIK_TOK_COLON;
+    }
+
+    uint32_t FlatAst::let_typedecl(const TokenBuffer& tokens, uint32_t let) {
+        uint32_t colon = skip_newlines(tokens, let_name(tokens, let) + 1);
+        return skip_newlines(tokens, colon + 1);
+    }
+
+
+    class Flattener : public ast::AstVisitor<Flattener> {
+    public:
+        explicit Flattener(const TokenBuffer& tokens) : tokens(tokens), next_token(0) { }
+
+        void enter(ast::Node* node) {
+            open.push_back(ast.size());
+            ast.kinds.push_back(node->kind);
+            ast.tokens.push_back(token_index(node->token));
+            ast.sizes.push_back(0);
+        }
+
+        void leave(ast::Node* node) {
+            ast.sizes[open.back()] = ast.size() - open.back();
+            open.pop_back();
+        }
+
+        FlatAst ast;
+
+    private:
+        // The main tokens of nodes in preorder are in source order, so one
+        // pass over the tokens finds them all.
+        uint32_t token_index(const Token& token) {
+            while (next_token < tokens.size() && tokens.locs[next_token].offset < token.loc.offset) ++next_token;
+            if (next_token == tokens.size() || tokens.locs[next_token].offset != token.loc.offset) {
+                throw InternalCompilerError("flatten node without a token");
+            }
+
+            return next_token;
+        }
+
+        const TokenBuffer& tokens;
+        uint32_t next_token;
+
+        // The nodes entered but not left yet.
+        std::vector<NodeId> open;
+    };
+
+    FlatAst flatten(ast::CompoundStmt* program, const TokenBuffer& tokens) {
+        Flattener flattener(tokens);
+        flattener.visit(program);
+        return std::move(flattener.ast);
+    }
+
+
+    void check(const FlatAst& ast, const TokenBuffer& tokens) {
+        // Lets bind their name to their expression. The root is never bound,
+        // so node 0 means unbound.
+        ast::ScopedEnvironment<NodeId> env;
+
+        // For every expression the first node along its chain of aliases that
+        // isn't a name, as NameExpr::target.
+        std::vector<NodeId> targets(ast.size());
+
+        // The scopes to leave and lets to bind once the sweep is past their
+        // subtree, innermost last.
+        std::vector<NodeId> open;
+        auto finish = [&](NodeId node) {
+            if (ast.kinds[node] == ast::NodeKind::COMPOUND) {
+                env.leave_scope();
+                return;
+            }
+
+            uint32_t let = ast.tokens[node];
+            NodeId expr = ast.first_child(node);
+            if (FlatAst::let_has_typedecl(tokens, let)) {
+                auto& number = tokens.numbers[tokens.payloads[ast.tokens[targets[expr]]]];
+                auto typedecl = tokens.payloads[FlatAst::let_typedecl(tokens, let)];
+                ast::check_typedecl(ast::number_type(number), typedecl, tokens.locs[let]);
+            }
+
+            env.bind(tokens.payloads[FlatAst::let_name(tokens, let)], expr);
+        };
+
+        for (NodeId node = 0; node < ast.size(); ++node) {
+            for (; !open.empty() && ast.subtree_end(open.back()) == node; open.pop_back()) finish(open.back());
+
+            uint32_t token = ast.tokens[node];
+            switch (ast.kinds[node]) {
+            case ast::NodeKind::NUMBER:
+                targets[node] = node;
+                break;
+
+            case ast::NodeKind::NAME: {
+                Symbol name = tokens.payloads[token];
+                NodeId decl = env.lookup(name);
+                if (!decl) {
+                    throw SemanticError(op::format("undefined name '{}'", symbols().str(name)), tokens.locs[token]);
+                }
+
+                targets[node] = targets[decl];
+                break;
+            }
+
+            case ast::NodeKind::COMPOUND:
+                // The root is the global scope.
+                if (node == 0) break;
+                env.enter_scope();
+                open.push_back(node);
+                break;
+
+            case ast::NodeKind::LET:
+                if (env.bound_in_scope(tokens.payloads[FlatAst::let_name(tokens, token)])) {
+                    throw SemanticError("name defined multiple times in same scope", tokens.locs[token]);
+                }
+
+                open.push_back(node);
+                break;
+
+            case ast::NodeKind::RETURN:
+                break;
+            }
+        }
+
+        for (; !open.empty(); open.pop_back()) finish(open.back());
+    }
+}
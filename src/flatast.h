@@ -0,0 +1,52 @@
+#ifndef KWIK_FLATAST_H
+#define KWIK_FLATAST_H
+
+#include <vector>
+#include <cstdint>
+
+#include "ast.h"
+#include "lexer.h"
+
+
+// A parsed program as parallel arrays, in the style of the parse trees of Zig
+// and Carbon. A node is nothing but its kind, the index of its main token in
+// the TokenBuffer it was parsed from and the size of its subtree, itself
+// included. Everything else is read from the tokens: numbers and names are
+// their token, a let's name is the first name after the let and its type the
+// name after the colon, if any.
+//
+// Nodes are in preorder, the root first, and the subtrees of the children of
+// a node follow it one after another. Passes are a sweep over the arrays.
+//
+// Experimental: the compiler doesn't use it. The parser builds pointer nodes,
+// so for now a flat AST can only be made from those, and keeping both takes
+// more memory, not less. bench/flatast compares the two forms and
+// tests/flatast checks that both checkers agree.
+namespace kwik {
+    using NodeId = uint32_t;
+
+    struct FlatAst {
+        std::vector<ast::NodeKind> kinds;
+        std::vector<uint32_t> tokens;
+        std::vector<uint32_t> sizes;
+
+        size_t size() const { return kinds.size(); }
+        NodeId first_child(NodeId node) const { return node + 1; }
+        NodeId next_sibling(NodeId node) const { return node + sizes[node]; }
+        NodeId subtree_end(NodeId node) const { return node + sizes[node]; }
+
+        // The tokens of a let, by the index of its main token.
+        static uint32_t let_name(const TokenBuffer& tokens, uint32_t let);
+        static bool let_has_typedecl(const TokenBuffer& tokens, uint32_t let);
+        static uint32_t let_typedecl(const TokenBuffer& tokens, uint32_t let);
+    };
+
+    // Flattens a program parsed from tokens.
+    FlatAst flatten(ast::CompoundStmt* program, const TokenBuffer& tokens);
+
+    // Resolves names and checks types as ast::check does, reporting the same
+    // errors, in a single sweep.
+    void check(const FlatAst& ast, const TokenBuffer& tokens);
+}
+
+#endif
@@ -0,0 +1,322 @@
+#include "precompile.h"
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "floatconv.h"
+
+
+namespace kwik {
+    struct Uint128 {
+        uint64_t hi;
+        uint64_t lo;
+    };
+
+    static Uint128 mul_64x64(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+        __extension__ typedef unsigned __int128 u128;
+        u128 r = u128(a) * b;
+        return {uint64_t(r >> 64), uint64_t(r)};
+#else
+        uint64_t a_lo = uint32_t(a), a_hi = a >> 32;
+        uint64_t b_lo = uint32_t(b), b_hi = b >> 32;
+        uint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi, p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+        uint64_t mid = (p0 >> 32) + uint32_t(p1) + uint32_t(p2);
+        return {p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32), (mid << 32) | uint32_t(p0)};
+#endif
+    }
+
+    static int leading_zeros(uint64_t x) {
+#ifdef __GNUC__
+        return __builtin_clzll(x);
+#else
+        int n = 0;
+        while (!(x & (uint64_t(1) << 63))) { x <<= 1; ++n; }
+        return n;
+#endif
+    }
+
+
+    // Minimal unsigned big integer, only used to compute the power of five table.
+    struct BigNum {
+        std::vector<uint32_t> limbs; // Little endian.
+
+        int bit_length() const {
+            for (int i = int(limbs.size()) - 1; i >= 0; --i) {
+                if (!limbs[i]) continue;
+                int n = 32*i;
+                for (uint32_t x = limbs[i]; x; x >>= 1) ++n;
+                return n;
+            }
+            return 0;
+        }
+
+        bool bit(int i) const { return (limbs[i / 32] >> (i % 32)) & 1; }
+
+        void mul_small(uint32_t m) {
+            uint64_t carry = 0;
+            for (auto& limb : limbs) {
+                carry += uint64_t(limb) * m;
+                limb = uint32_t(carry);
+                carry >>= 32;
+            }
+            if (carry) limbs.push_back(uint32_t(carry));
+        }
+
+        void div_small(uint32_t d) {
+            uint64_t rem = 0;
+            for (int i = int(limbs.size()) - 1; i >= 0; --i) {
+                uint64_t cur = (rem << 32) | limbs[i];
+                limbs[i] = uint32_t(cur / d);
+                rem = cur % d;
+            }
+        }
+
+        // The bits [lo, lo + 128) as a 128-bit number, lo may be negative.
+        Uint128 bits128(int lo) const {
+            Uint128 r = {0, 0};
+            for (int i = 127; i >= 0; --i) {
+                int j = lo + i;
+                bool b = j >= 0 && j < 32*int(limbs.size()) && bit(j);
+                if (i >= 64) r.hi |= uint64_t(b) << (i - 64);
+                else r.lo |= uint64_t(b) << i;
+            }
+            return r;
+        }
+    };
+
+
+    // Eisel-Lemire multiplies by 5^q, normalized to 128 bits with the top bit
+    // set. For q >= 0 it's truncated, for q < 0 it's the reciprocal rounded up
+    // (the exact construction the algorithm's error analysis assumes). This
+    // takes a few hundred microseconds to compute, so it's done on first use.
+    constexpr int SMALLEST_POW10 = -342;
+    constexpr int LARGEST_POW10 = 308;
+    using Pow5Table = std::array<Uint128, LARGEST_POW10 - SMALLEST_POW10 + 1>;
+
+    static Pow5Table make_pow5_table() {
+        Pow5Table table;
+
+        BigNum pow5 = {{1}};
+        for (int q = 0; q <= LARGEST_POW10; ++q) {
+            table[q - SMALLEST_POW10] = pow5.bits128(pow5.bit_length() - 128);
+            pow5.mul_small(5);
+        }
+
+        // inv holds floor(2^B / 5^p), and since floor(floor(x) / 5) = floor(x / 5)
+        // we can get there by repeated division. Then floor(2^b / 5^p) is inv
+        // shifted right by B - b.
+        constexpr int B = 1760;
+        BigNum inv = {std::vector<uint32_t>(B / 32 + 1)};
+        inv.limbs.back() = 1;
+        pow5 = {{1}};
+        for (int p = 1; p <= -SMALLEST_POW10; ++p) {
+            inv.div_small(5);
+            pow5.mul_small(5);
+
+            // With z = bit_length(5^p) we take floor(2^b / 5^p) + 1 for
+            // b = z + 127 (exactly 128 bits) if p <= 27, and b = 2z + 128
+            // otherwise, truncated to 128 bits.
+            int z = pow5.bit_length();
+            int b = p <= 27 ? z + 127 : 2*z + 128;
+            int shift = B - b;
+            int len = inv.bit_length() - shift;
+            int lo = shift + len - 128;
+
+            // Adding one carries into the kept bits iff all dropped bits are set.
+            bool carry = true;
+            for (int i = shift; i < lo && carry; ++i) carry = inv.bit(i);
+
+            Uint128 r = inv.bits128(lo);
+            if (carry) {
+                if (++r.lo == 0) ++r.hi;
+                if (r.hi == 0 && r.lo == 0) r.hi = uint64_t(1) << 63; // Became 2^128.
+            }
+            table[-p - SMALLEST_POW10] = r;
+        }
+
+        return table;
+    }
+
+    static const Pow5Table& pow5_table() {
+        static const Pow5Table table = make_pow5_table();
+        return table;
+    }
+
+
+    struct FloatFormat {
+        int mantissa_bits; // Explicitly stored.
+        int min_exponent;
+        int infinite_power;
+        int min_round_to_even;
+        int max_round_to_even;
+    };
+
+    static const FloatFormat f64_format = {52, -1023, 0x7ff, -4, 23};
+    static const FloatFormat f32_format = {23, -127, 0xff, -17, 10};
+
+    // Computes the bits of w * 10^q rounded to nearest even. Returns false if
+    // that can't be decided from a 128-bit product, or the result is subnormal,
+    // zero or infinite by underflow/overflow of the table.
+    static bool eisel_lemire(uint64_t w, int64_t q, const FloatFormat& fmt, uint64_t& bits) {
+        if (q < SMALLEST_POW10 || q > LARGEST_POW10) return false;
+
+        int lz = leading_zeros(w);
+        w <<= lz;
+
+        const Uint128& pow5 = pow5_table()[q - SMALLEST_POW10];
+        Uint128 product = mul_64x64(w, pow5.hi);
+        uint64_t precision_mask = ~uint64_t(0) >> (fmt.mantissa_bits + 3);
+        if ((product.hi & precision_mask) == precision_mask) {
+            Uint128 low = mul_64x64(w, pow5.lo);
+            product.lo += low.hi;
+            if (low.hi > product.lo) ++product.hi;
+        }
+
+        // Only exact for 5^q < 2^128 or 5^-q < 2^64, otherwise the lost bits
+        // might still carry.
+        if (product.lo == ~uint64_t(0) && (q < -27 || q > 55)) return false;
+
+        int upperbit = int(product.hi >> 63);
+        int shift = upperbit + 64 - fmt.mantissa_bits - 3;
+        uint64_t mantissa = product.hi >> shift;
+        int power2 = int(((152170 + 65536) * q) >> 16) + 63 + upperbit - lz - fmt.min_exponent;
+        if (power2 <= 0) return false;
+
+        // Exactly halfway between two floats, round to even instead of up.
+        if (product.lo <= 1 && q >= fmt.min_round_to_even && q <= fmt.max_round_to_even &&
+            (mantissa & 3) == 1 && (mantissa << shift) == product.hi) {
+            mantissa &= ~uint64_t(1);
+        }
+
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        if (mantissa >= (uint64_t(2) << fmt.mantissa_bits)) {
+            mantissa = uint64_t(1) << fmt.mantissa_bits;
+            ++power2;
+        }
+
+        mantissa &= ~(uint64_t(1) << fmt.mantissa_bits);
+        if (power2 >= fmt.infinite_power) {
+            power2 = fmt.infinite_power;
+            mantissa = 0;
+        }
+
+        bits = mantissa | (uint64_t(power2) << fmt.mantissa_bits);
+        return true;
+    }
+
+
+    // The literal as w * 10^q, where w holds the first 19 significant digits.
+    // If any dropped digit was nonzero the literal is truncated.
+    struct Decimal {
+        uint64_t w;
+        int64_t q;
+        bool truncated;
+    };
+
+    static Decimal parse_decimal(const char* begin, const char* end) {
+        Decimal d = {0, 0, false};
+        int digits = 0;
+        bool fraction = false;
+        for (const char* p = begin; p != end; ++p) {
+            if (*p == '.') {
+                fraction = true;
+                continue;
+            }
+
+            int digit = *p - '0';
+            if (digits < 19) {
+                d.w = 10*d.w + digit;
+                if (d.w) ++digits;
+                if (fraction) --d.q;
+            } else {
+                if (!fraction) ++d.q;
+                if (digit) d.truncated = true;
+            }
+        }
+
+        return d;
+    }
+
+    // A truncated literal lies between w and w + 1, if both round the same way
+    // so does the literal.
+    static bool fast_parse(const Decimal& d, const FloatFormat& fmt, uint64_t& bits) {
+        if (d.w == 0) {
+            bits = 0;
+            return true;
+        }
+
+        if (!eisel_lemire(d.w, d.q, fmt, bits)) return false;
+        if (!d.truncated) return true;
+
+        uint64_t bits_up;
+        return eisel_lemire(d.w + 1, d.q, fmt, bits_up) && bits_up == bits;
+    }
+
+    // strtod needs a null-terminated string, our literals are followed by the
+    // rest of the source.
+    template<class F>
+    static auto with_c_str(const char* begin, const char* end, F f) -> decltype(f("")) {
+        size_t len = end - begin;
+        char buf[128];
+        if (len < sizeof(buf)) {
+            std::memcpy(buf, begin, len);
+            buf[len] = 0;
+            return f(buf);
+        }
+
+        return f(std::string(begin, end).c_str());
+    }
+
+    double parse_f64(const char* begin, const char* end) {
+        Decimal d = parse_decimal(begin, end);
+
+#if FLT_EVAL_METHOD == 0
+        // Clinger's fast path: both w and 10^|q| are exact doubles, so a
+        // single rounded operation gives the correct result.
+        static const double pow10[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        if (!d.truncated && d.w <= uint64_t(1) << 53 && d.q >= -22 && d.q <= 22) {
+            return d.q < 0 ? double(d.w) / pow10[-d.q] : double(d.w) * pow10[d.q];
+        }
+#endif
+
+        uint64_t bits;
+        if (fast_parse(d, f64_format, bits)) {
+            double r;
+            std::memcpy(&r, &bits, sizeof(r));
+            return r;
+        }
+
+        return with_c_str(begin, end, [](const char* s) { return std::strtod(s, nullptr); });
+    }
+
+    float parse_f32(const char* begin, const char* end) {
+        Decimal d = parse_decimal(begin, end);
+
+#if FLT_EVAL_METHOD == 0
+        static const float pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+        if (!d.truncated && d.w <= uint64_t(1) << 24 && d.q >= -10 && d.q <= 10) {
+            return d.q < 0 ? float(d.w) / pow10[-d.q] : float(d.w) * pow10[d.q];
+        }
+#endif
+
+        uint64_t bits;
+        if (fast_parse(d, f32_format, bits)) {
+            uint32_t bits32 = uint32_t(bits);
+            float r;
+            std::memcpy(&r, &bits32, sizeof(r));
+            return r;
+        }
+
+        return with_c_str(begin, end, [](const char* s) { return std::strtof(s, nullptr); });
+    }
+}
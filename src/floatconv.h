@@ -0,0 +1,16 @@
+#ifndef KWIK_FLOATCONV_H
+#define KWIK_FLOATCONV_H
+
+// Correctly rounded conversion of decimal float literals, using the
+// Eisel-Lemire algorithm with a strtod fallback for the rare inputs it can't
+// decide.
+
+namespace kwik {
+    // [begin, end) must be a non-empty run of decimal digits with at most one
+    // '.' in it, and no sign or exponent. Values too large to represent give
+    // infinity.
+    double parse_f64(const char* begin, const char* end);
+    float parse_f32(const char* begin, const char* end);
+}
+
+#endif
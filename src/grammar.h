@@ -0,0 +1,12 @@
+#define KWIK_TOK_NL                               1
+#define KWIK_TOK_SEMICOLON                        2
+#define KWIK_TOK_OPEN_BRACE                       3
+#define KWIK_TOK_CLOSE_BRACE                      4
+#define KWIK_TOK_LET                              5
+#define KWIK_TOK_NAME                             6
+#define KWIK_TOK_EQUALS                           7
+#define KWIK_TOK_COLON                            8
+#define KWIK_TOK_RETURN                           9
+#define KWIK_TOK_OPEN_PAREN                      10
+#define KWIK_TOK_CLOSE_PAREN                     11
+#define KWIK_TOK_NUM                             12
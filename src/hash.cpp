@@ -0,0 +1,75 @@
+#include "precompile.h"
+
+#include <cstring>
+
+#include "hash.h"
+
+
+namespace kwik {
+    static const uint64_t PRIME1 = 0x9e3779b185ebca87ull;
+    static const uint64_t PRIME2 = 0xc2b2ae3d27d4eb4full;
+    static const uint64_t PRIME3 = 0x165667b19e3779f9ull;
+    static const uint64_t PRIME4 = 0x85ebca77c2b2ae63ull;
+    static const uint64_t PRIME5 = 0x27d4eb2f165667c5ull;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    // The hash is defined on little endian words.
+    static uint64_t read64(const unsigned char* p) {
+        uint64_t x = 0;
+        for (int i = 7; i >= 0; --i) x = (x << 8) | p[i];
+        return x;
+    }
+
+    static uint32_t read32(const unsigned char* p) {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * PRIME2;
+        return rotl(acc, 31) * PRIME1;
+    }
+
+    static uint64_t merge_round(uint64_t acc, uint64_t val) {
+        acc ^= round(0, val);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    uint64_t hash64(const void* data, size_t len, uint64_t seed) {
+        auto p = static_cast<const unsigned char*>(data);
+        auto end = p + len;
+        uint64_t h;
+
+        if (len >= 32) {
+            uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (end - p >= 32);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = merge_round(h, v1);
+            h = merge_round(h, v2);
+            h = merge_round(h, v3);
+            h = merge_round(h, v4);
+        } else h = seed + PRIME5;
+
+        h += len;
+        for (; end - p >= 8; p += 8) h = rotl(h ^ round(0, read64(p)), 27) * PRIME1 + PRIME4;
+        if (end - p >= 4) {
+            h = rotl(h ^ (read32(p) * PRIME1), 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        for (; p < end; ++p) h = rotl(h ^ (*p * PRIME5), 11) * PRIME1;
+
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef KWIK_HASH_H
+#define KWIK_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace kwik {
+    // XXH64, a fast non-cryptographic hash of good quality for long inputs.
+    // Results are the same as the reference implementation's on every platform.
+    uint64_t hash64(const void* data, size_t len, uint64_t seed = 0);
+}
+
+#endif
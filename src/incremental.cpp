@@ -0,0 +1,311 @@
+#include "precompile.h"
+
+#include <algorithm>
+#include "libop/op.h"
+
+#include "incremental.h"
+#include "parser.h"
+#include "grammar.h"
+
+void* KwikParseAlloc(void* (*alloc_proc)(size_t));
+void KwikParse(void* state, int token_id, kwik::Token token_data, kwik::ParseState* s);
+void KwikParseFree(void*, void(*free_proc)(void*));
+
+
+
+namespace kwik {
+    // Collects the token ranges of the top-level statements in tokens [begin,
+    // end), where begin is inside the outer braces. Returns the index of the
+    // closing outer brace, or end if there is none.
+    static size_t find_stmts(const TokenBuffer& tokens, size_t begin, size_t end,
+                             std::vector<uint32_t>& first, std::vector<uint32_t>& last) {
+        int depth = 1;
+        bool in_stmt = false;
+        for (size_t i = begin; i < end; ++i) {
+            int type = tokens.types[i];
+            if (depth == 1) {
+                if (type == KWIK_TOK_CLOSE_BRACE) return i;
+                if (type == KWIK_TOK_NL || type == KWIK_TOK_SEMICOLON) {
+                    in_stmt = false;
+                    continue;
+                }
+
+                if (!in_stmt) {
+                    first.push_back(i);
+                    last.push_back(i);
+                    in_stmt = true;
+                }
+            }
+
+            if (type == KWIK_TOK_OPEN_BRACE) ++depth;
+            else if (type == KWIK_TOK_CLOSE_BRACE) --depth;
+            last.back() = i;
+        }
+
+        return end;
+    }
+
+    // Replaces v[begin, end) by with, only moving the tail if the size changes.
+    template<class T>
+    static void splice(std::vector<T>& v, size_t begin, size_t end, const std::vector<T>& with) {
+        size_t common = std::min(end - begin, with.size());
+        std::copy(with.begin(), with.begin() + common, v.begin() + begin);
+        if (common < with.size()) v.insert(v.begin() + begin + common, with.begin() + common, with.end());
+        else v.erase(v.begin() + begin + common, v.begin() + end);
+    }
+
+
+    IncrementalParse::IncrementalParse(SharedSource src, uint32_t max_nesting)
+        : src(std::move(src)), max_nesting(max_nesting), prog(nullptr), clean(false),
+          open_brace(0), close_brace(0), garbage(0) {
+        full_parse();
+    }
+
+    void IncrementalParse::edit(size_t offset, size_t len, const std::string& text) {
+        if (offset > src->code_size || len > src->code_size - offset) {
+            throw InternalCompilerError("edit out of range");
+        }
+
+        const char* code = src->code.get();
+        std::string new_code;
+        new_code.reserve(src->code_size - len + text.size());
+        new_code.append(code, offset);
+        new_code += text;
+        new_code.append(code + offset + len, src->code_size - offset - len);
+        size_t new_size = new_code.size();
+        SharedSource new_src = make_source_shared(new_code, src->name);
+
+        // Normalization (of carriage returns in text) may have changed the
+        // size, then old locations are meaningless.
+        if (new_src->code_size != new_size) {
+            src = std::move(new_src);
+            full_parse();
+        } else apply(std::move(new_src), offset, len, text.size());
+    }
+
+    void IncrementalParse::update(SharedSource new_src) {
+        const char* old_code = src->code.get();
+        const char* new_code = new_src->code.get();
+        size_t old_size = src->code_size, new_size = new_src->code_size;
+
+        size_t prefix = 0;
+        size_t max_common = std::min(old_size, new_size);
+        while (prefix < max_common && old_code[prefix] == new_code[prefix]) ++prefix;
+        size_t suffix = 0;
+        while (suffix < max_common - prefix && old_code[old_size - suffix - 1] == new_code[new_size - suffix - 1]) {
+            ++suffix;
+        }
+
+        apply(std::move(new_src), prefix, old_size - prefix - suffix, new_size - prefix - suffix);
+    }
+
+    void IncrementalParse::apply(SharedSource new_src, size_t offset, size_t old_len, size_t new_len) {
+        // Keep the old source until everything moved to the new one.
+        SharedSource old_src = std::move(src);
+        src = std::move(new_src);
+        if (!clean || garbage > tokens.size()) return full_parse();
+
+        // The new source is elsewhere in the location space, so first move
+        // all old locations over as if nothing changed. Offsets wrap around.
+        int32_t base_delta = int32_t(src->base - old_src->base);
+        if (base_delta) {
+            for (auto& loc : tokens.locs) loc.offset += base_delta;
+            ast::relocate(prog, base_delta);
+        }
+
+        if (try_edit(offset, old_len, new_len)) {
+            errs.clear();
+            check();
+        } else full_parse();
+    }
+
+    void IncrementalParse::full_parse() {
+        if (arena) arena->reset();
+        else arena.reset(new AstArena);
+        tokens = TokenBuffer();
+        prog = nullptr;
+        errs.clear();
+        clean = false;
+        stmts.clear();
+        stmt_first.clear();
+        stmt_last.clear();
+        garbage = 0;
+
+        Lexer{*src}.lex_all(tokens);
+        stats = {true, tokens.size(), 0};
+
+        auto parser = KwikParseAlloc(malloc);
+        OP_SCOPE_EXIT { KwikParseFree(parser, free); };
+
+        // Lexer errors are interleaved as in parse().
+        ParseState state{*src, *arena, max_nesting};
+        auto error = tokens.errors.begin();
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            for (; error != tokens.errors.end() && error->first == i; ++error) {
+                state.errors.push_back(std::move(error->second));
+            }
+
+            Token token = tokens.get(i);
+            if (!state.track_nesting(token)) break;
+            KwikParse(parser, token.type, token, &state);
+        }
+
+        tokens.errors.clear();
+        prog = state.program;
+        errs = std::move(state.errors);
+
+        if (prog && errs.empty()) {
+            open_brace = 0;
+            while (tokens.types[open_brace] == KWIK_TOK_NL) ++open_brace;
+            close_brace = find_stmts(tokens, open_brace + 1, tokens.size(), stmt_first, stmt_last);
+            clean = close_brace < tokens.size() && stmt_first.size() == prog->stmt_list.size;
+            stats.stmts_parsed = prog->stmt_list.size;
+            stmts.assign(prog->stmt_list.begin(), prog->stmt_list.end());
+            prog->stmt_list = {stmts.data(), stmts.size()};
+        }
+
+        check();
+    }
+
+    void IncrementalParse::check() {
+        if (!prog) return;
+
+        ast::Environment global_env;
+        try {
+            ast::check(prog, global_env);
+        } catch (const CompilationError& e) {
+            errs.emplace_back(e.clone());
+        }
+    }
+
+    bool IncrementalParse::try_edit(size_t offset, size_t old_len, size_t new_len) {
+        auto off = [&](size_t i) { return src->offset(tokens.locs[i]); };
+        int32_t delta = int32_t(new_len - old_len);
+        size_t num_stmts = stmt_first.size();
+
+        // Edits to the outer braces or outside of them aren't incremental.
+        if (offset <= off(open_brace) || offset + old_len > off(close_brace)) return false;
+
+        // The first statement the edit might touch is the first one that doesn't
+        // end before it. We start at the one before that, as the edit might
+        // remove the separator in between. Before the first statement we start
+        // right after the opening brace.
+        size_t k = std::partition_point(stmt_last.begin(), stmt_last.end(), [&](uint32_t last) {
+            return off(last) + tokens.lens[last] < offset;
+        }) - stmt_last.begin();
+        size_t first_stmt = k > 0 ? k - 1 : 0;
+        size_t tok_begin = first_stmt > 0 ? stmt_first[first_stmt] : open_brace + 1;
+
+        // Re-lex until a newline between statements that was also there before
+        // the edit, after which the old tokens are still valid. If there is no
+        // such newline we re-lex through the closing brace to the end.
+        TokenBuffer fresh;
+        Lexer lex{*src, off(tok_begin - 1) + tokens.lens[tok_begin - 1]};
+        size_t sync = tokens.size();
+        size_t end_stmt = num_stmts;
+        size_t fresh_close_brace = 0;
+        int depth = 1;
+        try {
+            while (true) {
+                Token token = lex.get_token();
+                if (token.type == 0) return false;
+
+                if (token.type == KWIK_TOK_OPEN_BRACE) ++depth;
+                else if (token.type == KWIK_TOK_CLOSE_BRACE && --depth == 0) {
+                    fresh_close_brace = fresh.size();
+                    fresh.push(token);
+                    do {
+                        token = lex.get_token();
+                        fresh.push(token);
+                    } while (token.type == KWIK_TOK_NL);
+
+                    if (token.type != 0) return false;
+                    break;
+                } else if (token.type == KWIK_TOK_NL && depth == 1 && src->offset(token.loc) >= offset + new_len) {
+                    uint32_t old_loc = token.loc.offset - delta;
+                    size_t j = std::lower_bound(tokens.locs.begin() + tok_begin, tokens.locs.begin() + close_brace, old_loc,
+                        [](SourceLoc loc, uint32_t x) { return loc.offset < x; }) - tokens.locs.begin();
+                    if (j < close_brace && tokens.locs[j].offset == old_loc && tokens.types[j] == KWIK_TOK_NL) {
+                        // It must not be inside a statement, in a nested block.
+                        size_t m = std::upper_bound(stmt_first.begin(), stmt_first.end(), j) - stmt_first.begin();
+                        if (m == 0 || stmt_last[m - 1] < j) {
+                            sync = j;
+                            end_stmt = m;
+                            break;
+                        }
+                    }
+                }
+
+                fresh.push(token);
+            }
+        } catch (const CompilationError&) {
+            return false;
+        }
+
+        // Parse the new statements on their own by wrapping them in the outer
+        // braces. Anything but a clean parse is left to a full parse, which
+        // reports errors the same way as always.
+        bool synced = sync < tokens.size();
+        size_t region_end = synced ? fresh.size() : fresh_close_brace;
+        auto parser = KwikParseAlloc(malloc);
+        OP_SCOPE_EXIT { KwikParseFree(parser, free); };
+
+        ParseState state{*src, *arena, max_nesting};
+        Token open = tokens.get(open_brace), close = tokens.get(close_brace);
+        state.track_nesting(open);
+        KwikParse(parser, KWIK_TOK_OPEN_BRACE, open, &state);
+        for (size_t i = 0; i < region_end; ++i) {
+            Token token = fresh.get(i);
+            if (!state.track_nesting(token)) return false;
+            KwikParse(parser, token.type, token, &state);
+        }
+
+        KwikParse(parser, KWIK_TOK_CLOSE_BRACE, close, &state);
+        KwikParse(parser, 0, Token{0, close.loc, 0}, &state);
+        if (!state.program || !state.errors.empty()) return false;
+
+        std::vector<uint32_t> new_first, new_last;
+        find_stmts(fresh, 0, region_end, new_first, new_last);
+        auto new_stmts = state.program->stmt_list;
+        if (new_first.size() != new_stmts.size) return false;
+
+        // Everything checks out, splice in the new tokens and statements.
+        size_t old_count = sync - tok_begin;
+        size_t new_count = fresh.size();
+        uint32_t numbers_base = tokens.numbers.size();
+        for (size_t i = 0; i < new_count; ++i) {
+            if (fresh.types[i] == KWIK_TOK_NUM) fresh.payloads[i] += numbers_base;
+        }
+
+        splice(tokens.types, tok_begin, sync, fresh.types);
+        splice(tokens.locs, tok_begin, sync, fresh.locs);
+        splice(tokens.lens, tok_begin, sync, fresh.lens);
+        splice(tokens.payloads, tok_begin, sync, fresh.payloads);
+        tokens.numbers.insert(tokens.numbers.end(), fresh.numbers.begin(), fresh.numbers.end());
+        if (delta) {
+            for (size_t i = tok_begin + new_count; i < tokens.size(); ++i) tokens.locs[i].offset += delta;
+            for (size_t i = end_stmt; i < num_stmts; ++i) ast::relocate(stmts[i], delta);
+        }
+
+        splice(stmts, first_stmt, end_stmt, std::vector<ast::Stmt*>(new_stmts.begin(), new_stmts.end()));
+        prog->stmt_list = {stmts.data(), stmts.size()};
+
+        uint32_t tok_delta = uint32_t(new_count - old_count);
+        for (auto& i : new_first) i += tok_begin;
+        for (auto& i : new_last) i += tok_begin;
+        if (tok_delta) {
+            for (size_t i = end_stmt; i < num_stmts; ++i) {
+                stmt_first[i] += tok_delta;
+                stmt_last[i] += tok_delta;
+            }
+        }
+
+        splice(stmt_first, first_stmt, end_stmt, new_first);
+        splice(stmt_last, first_stmt, end_stmt, new_last);
+        close_brace = synced ? close_brace + tok_delta : tok_begin + fresh_close_brace;
+
+        garbage += old_count;
+        stats = {false, new_count, new_stmts.size};
+        return true;
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef KWIK_INCREMENTAL_H
+#define KWIK_INCREMENTAL_H
+
+#include <string>
+#include <memory>
+#include <vector>
+
+#include "ast.h"
+#include "io.h"
+#include "lexer.h"
+#include "arena.h"
+#include "exception.h"
+#include "parser.h"
+
+
+namespace kwik {
+    // A parse of a source that's kept up to date as the source is edited. An
+    // edit re-lexes from the top-level statement before it up to the first
+    // newline after it that lines up with an old statement boundary, re-parses
+    // only the top-level statements in between and reuses the rest of the
+    // tokens and AST, moving their locations. Anything it can't handle that
+    // way, such as sources with syntax errors or edits to the outer braces,
+    // falls back to a full parse. Either way the result is the same as that of
+    // parsing the edited source from scratch.
+    class IncrementalParse {
+    public:
+        explicit IncrementalParse(SharedSource src, uint32_t max_nesting = DEFAULT_MAX_NESTING);
+
+        // Replaces len bytes at offset with text.
+        void edit(size_t offset, size_t len, const std::string& text);
+
+        // Moves on to a new version of the source, as a single edit of the
+        // bytes between their common prefix and suffix.
+        void update(SharedSource new_src);
+
+        // Every edit makes a new source and moves the locations of the parse
+        // to it. The old one is released, so a reference is needed to keep
+        // using errors past the next edit.
+        const SharedSource& source() const { return src; }
+        ast::CompoundStmt* program() const { return prog; }
+        const std::vector<std::unique_ptr<CompilationError>>& errors() const { return errs; }
+
+        // What the last parse or edit did.
+        struct Stats {
+            bool full;
+            size_t tokens_lexed;
+            size_t stmts_parsed;
+        };
+
+        const Stats& last_stats() const { return stats; }
+
+    private:
+        void apply(SharedSource new_src, size_t offset, size_t old_len, size_t new_len);
+        void full_parse();
+        bool try_edit(size_t offset, size_t old_len, size_t new_len);
+        void check();
+
+        SharedSource src;
+        uint32_t max_nesting;
+        std::unique_ptr<AstArena> arena;
+        TokenBuffer tokens;
+        ast::CompoundStmt* prog;
+        std::vector<std::unique_ptr<CompilationError>> errs;
+
+        // Only a source without lexer or syntax errors can be edited
+        // incrementally. For those we know the top-level statements, which the
+        // program's list points into so edits don't copy it, their token ranges
+        // (first and last token, inclusive) and the outer braces.
+        bool clean;
+        std::vector<ast::Stmt*> stmts;
+        std::vector<uint32_t> stmt_first;
+        std::vector<uint32_t> stmt_last;
+        uint32_t open_brace;
+        uint32_t close_brace;
+
+        // Replaced nodes stay in the arena until the next full parse, which we
+        // force once more tokens were replaced than there are.
+        size_t garbage;
+
+        Stats stats;
+    };
+}
+
+#endif
@@ -2,12 +2,19 @@
 
 #include <string>
 #include <memory>
+#include <mutex>
+#include <algorithm>
 #include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "libop/op.h"
 #include "utf8cpp/utf8.h"
 
 #include "io.h"
 #include "exception.h"
+#include "scan.h"
 
 
 namespace kwik {
@@ -28,32 +35,255 @@ namespace kwik {
     }
 
 
-    constexpr int Source::NULL_BYTES_APPENDED;
+    static Source make_source(const char* cbegin, const char* cend, const std::string& name);
+    static Source make_source_checked(const char* cbegin, const char* cend, const std::string& name);
 
-    Source read_stdin() {
-        return make_source(read_full_stream(stdin), "<stdin>");
+
+    // All loaded sources, ordered by base. Shared sources are owned by their
+    // shared_ptrs, the others by the registry.
+    struct Registered {
+        const Source* src;
+        std::unique_ptr<Source> owned;
+    };
+
+    static std::mutex sources_mutex;
+    static std::vector<Registered> sources;
+
+    // One location past the code is the end of the source.
+    static uint64_t range_end(const Source& src) {
+        return uint64_t(src.base) + src.code_size + 1;
     }
 
-    Source read_file(const std::string& filename) {
+    // Sets the base of src to the start of a free location range and returns
+    // where it goes in sources. New sources go after the last one, or once
+    // the location space runs out into the first gap that shared sources left
+    // that's large enough. Callers must hold sources_mutex.
+    static std::vector<Registered>::iterator reserve_range_locked(Source& src) {
+        uint64_t size = uint64_t(src.code_size) + 1;
+        uint64_t base = sources.empty() ? 0 : range_end(*sources.back().src);
+        auto pos = sources.end();
+        if (base + size > UINT32_MAX) {
+            base = 0;
+            for (pos = sources.begin(); pos != sources.end() && pos->src->base - base < size; ++pos) {
+                base = range_end(*pos->src);
+            }
+
+            if (pos == sources.end() && base + size > UINT32_MAX) {
+                throw FilesystemError("too much source code loaded (4 GiB limit)");
+            }
+        }
+
+        src.base = base;
+        return pos;
+    }
+
+    static std::vector<Registered>::iterator find_locked(const Source& src) {
+        auto it = std::lower_bound(sources.begin(), sources.end(), src.base,
+            [](const Registered& r, uint32_t base) { return r.src->base < base; });
+        if (it == sources.end() || it->src != &src) throw InternalCompilerError("unknown source");
+        return it;
+    }
+
+    static const Source& register_source(Source src) {
+        std::unique_ptr<Source> owned(new Source(std::move(src)));
+        std::lock_guard<std::mutex> lock(sources_mutex);
+        auto pos = reserve_range_locked(*owned);
+        const Source& result = *owned;
+        sources.insert(pos, {&result, std::move(owned)});
+        return result;
+    }
+
+    static SharedSource register_shared_source(Source src) {
+        std::unique_ptr<Source> shared(new Source(std::move(src)));
+        {
+            std::lock_guard<std::mutex> lock(sources_mutex);
+            auto pos = reserve_range_locked(*shared);
+            sources.insert(pos, {shared.get(), nullptr});
+        }
+
+        return SharedSource(shared.release(), [](const Source* src) {
+            {
+                std::lock_guard<std::mutex> lock(sources_mutex);
+                sources.erase(find_locked(*src));
+            }
+
+            delete src;
+        });
+    }
+
+    const Source& source_of(SourceLoc loc) {
+        std::lock_guard<std::mutex> lock(sources_mutex);
+        auto it = std::upper_bound(sources.begin(), sources.end(), loc.offset,
+            [](uint32_t offset, const Registered& r) { return offset < r.src->base; });
+        if (it == sources.begin() || loc.offset >= range_end(*(--it)->src)) {
+            throw InternalCompilerError("invalid source location");
+        }
+
+        return *it->src;
+    }
+
+
+    static Source read_file_stream(const std::string& filename, const std::string& name) {
         auto file = std::fopen(filename.c_str(), "r");
         if (!file) throw kwik::FilesystemError(std::strerror(errno));
         OP_SCOPE_EXIT { std::fclose(file); };
-        return make_source(read_full_stream(file), filename);
+        auto src = read_full_stream(file);
+        return make_source(src.data(), src.data() + src.size(), name);
+    }
+
+    // Maps size bytes of fd read-only, followed by at least NULL_BYTES_APPENDED
+    // null bytes. We reserve an anonymous region for the file plus padding and
+    // map the file over the start of it. The tail of the last file page is zero
+    // filled by mmap, and any page beyond it stays an anonymous zero page.
+    static std::shared_ptr<const char> map_file(int fd, size_t size) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t total = (size + Source::NULL_BYTES_APPENDED + page - 1) / page * page;
+        void* region = mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) return nullptr;
+        if (mmap(region, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(region, total);
+            return nullptr;
+        }
+
+        return std::shared_ptr<const char>(static_cast<const char*>(region),
+                                           [total](const char* p) { munmap((void*) p, total); });
+    }
+
+    // Returns true if [begin, end) is valid UTF-8 that make_source would leave
+    // untouched, that is without byte order mark, carriage returns or null bytes.
+    static bool is_normalized(const char* begin, const char* end) {
+        if (utf8::starts_with_bom(begin, end)) return false;
+        auto scan = scan_utf8(begin, end);
+        return scan.valid && !scan.has_cr && !scan.has_nul;
+    }
+
+
+    constexpr int Source::NULL_BYTES_APPENDED;
+
+    const std::vector<uint32_t>& Source::line_starts() const {
+        auto cache = std::atomic_load(&line_starts_cache);
+        if (cache) return *cache;
+
+        auto starts = std::make_shared<std::vector<uint32_t>>();
+        const char* begin = code.get();
+        const char* end = begin + code_size;
+        starts->push_back(0);
+        for (const char* p = begin; ; ++p) {
+            p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!p) break;
+            starts->push_back(p + 1 - begin);
+        }
+
+        // If another thread got there first we use its index instead.
+        cache = starts;
+        std::shared_ptr<const std::vector<uint32_t>> expected;
+        if (!std::atomic_compare_exchange_strong(&line_starts_cache, &expected, cache)) cache = expected;
+        return *cache;
     }
 
+    LineCol Source::line_col(SourceLoc loc) const {
+        size_t off = offset(loc);
+        auto& starts = line_starts();
+        size_t line = std::upper_bound(starts.begin(), starts.end(), off) - starts.begin();
 
-    Source make_source(const std::string& src, const std::string& name) {
-        auto cbegin = src.data();
-        auto cend = src.data() + src.size();
+        // Count code points by skipping continuation bytes.
+        size_t col = 1;
+        for (const char* p = code.get() + starts[line - 1]; p < code.get() + off; ++p) {
+            col += (*p & 0xc0) != 0x80;
+        }
+
+        return {line, col};
+    }
+
+    std::string Source::line(size_t n) const {
+        auto& starts = line_starts();
+        const char* begin = code.get() + starts[n - 1];
+        const char* end = code.get() + (n < starts.size() ? starts[n] - 1 : code_size);
+        return {begin, end};
+    }
+
+    const Source& read_stdin() {
+        return make_source(read_full_stream(stdin), "<stdin>");
+    }
+
+    static Source load_file(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) throw kwik::FilesystemError(std::strerror(errno));
+        OP_SCOPE_EXIT { close(fd); };
+
+        struct stat st;
+        if (fstat(fd, &st) < 0) throw kwik::FilesystemError(std::strerror(errno));
+
+        // Pipes, devices and empty files can't be mapped.
+        if (!S_ISREG(st.st_mode) || st.st_size == 0) return read_file_stream(filename, filename);
+
+        size_t size = st.st_size;
+        auto mapping = map_file(fd, size);
+        if (!mapping) return read_file_stream(filename, filename);
+
+        // If the file is already clean we use the mapping as is, otherwise we
+        // fall back to a normalizing copy.
+        const char* begin = mapping.get();
+        const char* end = begin + size;
+        if (!is_normalized(begin, end)) return make_source(begin, end, filename);
+        return {filename, std::move(mapping), size};
+    }
+
+    const Source& read_file(const std::string& filename) {
+        return register_source(load_file(filename));
+    }
+
+    const Source& make_source(const std::string& src, const std::string& name) {
+        return register_source(make_source(src.data(), src.data() + src.size(), name));
+    }
+
+    SharedSource read_file_shared(const std::string& filename, const std::string& name) {
+        return register_shared_source(read_file_stream(filename, name));
+    }
+
+    SharedSource make_source_shared(const std::string& src, const std::string& name) {
+        return register_shared_source(make_source(src.data(), src.data() + src.size(), name));
+    }
+
+    static Source make_source(const char* cbegin, const char* cend, const std::string& name) {
         if (utf8::starts_with_bom(cbegin, cend)) cbegin += 3;
 
+        // Bad input takes the slow path, which pinpoints the error.
+        auto scan = scan_utf8(cbegin, cend);
+        if (!scan.valid || scan.has_nul) return make_source_checked(cbegin, cend, name);
+
+        std::string code; code.reserve(cend - cbegin + Source::NULL_BYTES_APPENDED);
+        if (!scan.has_cr) code.append(cbegin, cend);
+        else {
+            // Translate \r and \r\n to \n.
+            while (true) {
+                auto cr = static_cast<const char*>(std::memchr(cbegin, '\r', cend - cbegin));
+                if (!cr) break;
+                code.append(cbegin, cr);
+                code.push_back('\n');
+                cbegin = cr + 1;
+                if (cbegin != cend && *cbegin == '\n') ++cbegin;
+            }
+
+            code.append(cbegin, cend);
+        }
+
+        size_t code_size = code.size();
+        code.append(Source::NULL_BYTES_APPENDED, '\0');
+
+        auto buf = std::make_shared<std::string>(std::move(code));
+        return {name, std::shared_ptr<const char>(buf, buf->data()), code_size};
+    }
+
+    // Decodes and re-encodes code point by code point, with exact positions
+    // for encoding errors.
+    static Source make_source_checked(const char* cbegin, const char* cend, const std::string& name) {
         utf8::iterator<decltype(cbegin)> it{cbegin, cbegin, cend};
         utf8::iterator<decltype(cbegin)> end{cend, cbegin, cend};
 
-        std::string code; code.reserve(src.size());
+        std::string code; code.reserve(cend - cbegin + Source::NULL_BYTES_APPENDED);
         auto code_append = std::back_inserter(code);
 
-        std::vector<std::string> lines;
         auto line_start = code.begin();
         int line = 1;
         int col = 1;
@@ -70,7 +300,6 @@ namespace kwik {
 
                 // Translate \r and \r\n to \n.
                 if (c == '\r' || c == '\n') {
-                    lines.emplace_back(line_start, code.end());
                     utf8::append('\n', code_append);
                     line_start = code.end();
                     if (c == '\r' && it != end && *it == '\n') ++it;
@@ -93,12 +322,11 @@ namespace kwik {
                                 std::string(line_start, code.end()));
         }
 
-        // Append final line.
-        lines.emplace_back(line_start, code.end());
-
         // Append null bytes for lexer.
+        size_t code_size = code.size();
         for (int i = 0; i < Source::NULL_BYTES_APPENDED; ++i) code.push_back(0);
 
-        return {name, std::move(code), std::move(lines)};
+        auto buf = std::make_shared<std::string>(std::move(code));
+        return {name, std::shared_ptr<const char>(buf, buf->data()), code_size};
     }
 }
@@ -4,28 +4,70 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <cstdint>
 
 namespace kwik {
-    struct Source {
-        // To make the lexer fast (lookahead without bounds checks) we append
-        // null bytes to code. Subtract this from code.end() when you want a
-        // full range containing only the code.
-        constexpr static int NULL_BYTES_APPENDED = 8;
-
-        std::string name;
-        std::string code;
-        std::vector<std::string> lines;
+    // A position in any loaded source. Every source gets its own range in a
+    // single 32-bit offset space, so one integer identifies both the source
+    // and the position within it.
+    struct SourceLoc {
+        uint32_t offset;
     };
 
-    struct SourceRef {
-        const Source& src;
+    struct LineCol {
         size_t line;
         size_t col;
     };
-    
-    Source read_stdin();
-    Source read_file(const std::string& filename);
-    Source make_source(const std::string& src, const std::string& name);
+
+    struct Source {
+        // To make the lexer fast (lookahead and vector loads without bounds
+        // checks, see scan.h) we append null bytes to code. These are not
+        // included in code_size.
+        constexpr static int NULL_BYTES_APPENDED = 32;
+
+        std::string name;
+
+        // The normalized code, followed by NULL_BYTES_APPENDED null bytes. This
+        // is either a heap buffer or a read-only memory mapping of the file.
+        std::shared_ptr<const char> code;
+        size_t code_size;
+
+        // Start of this source in the location space.
+        uint32_t base;
+
+        SourceLoc loc(size_t offset) const { return {uint32_t(base + offset)}; }
+        size_t offset(SourceLoc loc) const { return loc.offset - base; }
+
+        // Line and column of loc (both 1-based, columns count code points).
+        LineCol line_col(SourceLoc loc) const;
+
+        // Returns line n (1-based) without its newline.
+        std::string line(size_t n) const;
+
+        // Offsets into code at which each line starts. Only diagnostics need
+        // these, so they are built on first use. Safe to call concurrently.
+        const std::vector<uint32_t>& line_starts() const;
+        mutable std::shared_ptr<const std::vector<uint32_t>> line_starts_cache;
+    };
+
+    // Sources live in a global registry, so a SourceLoc is all that's needed
+    // to find one. Most stay for the rest of the process.
+    const Source& read_stdin();
+    const Source& read_file(const std::string& filename);
+    const Source& make_source(const std::string& src, const std::string& name);
+
+    // A source that leaves the registry once the last reference to it is
+    // gone, which frees its location range for other sources. Locations in it
+    // mustn't be used after that.
+    using SharedSource = std::shared_ptr<const Source>;
+
+    // Reads filename into a private copy named name. Unlike read_file, which
+    // may map the file, later changes to the file can't affect the source.
+    SharedSource read_file_shared(const std::string& filename, const std::string& name);
+    SharedSource make_source_shared(const std::string& src, const std::string& name);
+
+    // Throws InternalCompilerError if loc isn't in any source in the registry.
+    const Source& source_of(SourceLoc loc);
 }
 
 
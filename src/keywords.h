@@ -0,0 +1,31 @@
+// Generated by kwgen from src/keywords.txt, do not edit.
+#ifndef KWIK_KEYWORDS_H
+#define KWIK_KEYWORDS_H
+
+#include <cstring>
+#include <cstdint>
+
+#include "grammar.h"
+
+
+namespace kwik {
+    // Returns the token type of the keyword [str, str + len), or 0 if it
+    // isn't a keyword.
+    inline int match_keyword(const char* str, size_t len) {
+        struct Entry { const char* str; size_t len; int token; };
+        static const Entry table[2] = {
+            {"return", 6, KWIK_TOK_RETURN},
+            {"let", 3, KWIK_TOK_LET},
+        };
+
+        if (len < 3 || len > 6) return 0;
+        uint32_t key = uint32_t((unsigned char) str[0])
+                     | uint32_t((unsigned char) str[len / 2]) << 8
+                     | uint32_t((unsigned char) str[len - 1]) << 16
+                     | uint32_t(len) << 24;
+        const Entry& e = table[uint32_t(key * 3913246305u) >> 31];
+        return e.len == len && !std::memcmp(e.str, str, len) ? e.token : 0;
+    }
+}
+
+#endif
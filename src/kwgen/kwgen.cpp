@@ -0,0 +1,140 @@
+// Generates a perfect hash function for the keyword list.
+//
+// Usage: kwgen <keywords.txt> <keywords.h>
+//
+// An identifier's length, first, middle and last character are packed into a
+// 32-bit key, which is hashed by multiplying with a constant and keeping the
+// top bits. We search for the smallest table and a multiplier for which no two
+// keywords collide, so recognizing a keyword costs one table lookup and a
+// single comparison.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+struct Keyword {
+    std::string word;
+    std::string token;
+};
+
+static uint32_t key(const std::string& w) {
+    return uint32_t((unsigned char) w[0]) | uint32_t((unsigned char) w[w.size() / 2]) << 8
+         | uint32_t((unsigned char) w[w.size() - 1]) << 16 | uint32_t(w.size()) << 24;
+}
+
+static uint32_t hash(uint32_t key, uint32_t mul, int bits) {
+    return uint32_t(key * mul) >> (32 - bits);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s <keywords.txt> <keywords.h>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::fprintf(stderr, "kwgen: can't open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<Keyword> keywords;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        Keyword kw;
+        if (!(ss >> kw.word >> kw.token)) {
+            std::fprintf(stderr, "kwgen: malformed line '%s'\n", line.c_str());
+            return 1;
+        }
+
+        keywords.push_back(kw);
+    }
+
+    if (keywords.empty()) {
+        std::fprintf(stderr, "kwgen: no keywords\n");
+        return 1;
+    }
+
+    size_t min_len = keywords[0].word.size(), max_len = min_len;
+    for (auto& kw : keywords) {
+        min_len = std::min(min_len, kw.word.size());
+        max_len = std::max(max_len, kw.word.size());
+    }
+
+    for (size_t i = 0; i < keywords.size(); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (key(keywords[i].word) == key(keywords[j].word)) {
+                std::fprintf(stderr, "kwgen: can't distinguish '%s' from '%s'\n",
+                             keywords[i].word.c_str(), keywords[j].word.c_str());
+                return 1;
+            }
+        }
+    }
+
+    // Deterministic multipliers, so the output only depends on the input.
+    int bits = 1;
+    while ((1u << bits) < keywords.size()) ++bits;
+    for (; bits <= 16; ++bits) {
+        uint32_t mul = 0x9e3779b9;
+        for (int attempt = 0; attempt < 100000; ++attempt) {
+            mul = mul * 1664525 + 1013904223;
+            mul |= 1;
+
+            std::vector<int> table(size_t(1) << bits, -1);
+            bool ok = true;
+            for (size_t i = 0; i < keywords.size() && ok; ++i) {
+                int& slot = table[hash(key(keywords[i].word), mul, bits)];
+                ok = slot < 0;
+                slot = i;
+            }
+
+            if (!ok) continue;
+
+            std::ofstream out(argv[2]);
+            out << "// Generated by kwgen from " << argv[1] << ", do not edit.\n"
+                << "#ifndef KWIK_KEYWORDS_H\n"
+                << "#define KWIK_KEYWORDS_H\n\n"
+                << "#include <cstring>\n"
+                << "#include <cstdint>\n\n"
+                << "#include \"grammar.h\"\n\n\n"
+                << "namespace kwik {\n"
+                << "    // Returns the token type of the keyword [str, str + len), or 0 if it\n"
+                << "    // isn't a keyword.\n"
+                << "    inline int match_keyword(const char* str, size_t len) {\n"
+                << "        struct Entry { const char* str; size_t len; int token; };\n"
+                << "        static const Entry table[" << table.size() << "] = {\n";
+            for (int i : table) {
+                if (i < 0) out << "            {\"\", 0, 0},\n";
+                else out << "            {\"" << keywords[i].word << "\", " << keywords[i].word.size()
+                         << ", KWIK_TOK_" << keywords[i].token << "},\n";
+            }
+            out << "        };\n\n"
+                << "        if (len < " << min_len << " || len > " << max_len << ") return 0;\n"
+                << "        uint32_t key = uint32_t((unsigned char) str[0])\n"
+                << "                     | uint32_t((unsigned char) str[len / 2]) << 8\n"
+                << "                     | uint32_t((unsigned char) str[len - 1]) << 16\n"
+                << "                     | uint32_t(len) << 24;\n"
+                << "        const Entry& e = table[uint32_t(key * " << mul << "u) >> " << 32 - bits << "];\n"
+                << "        return e.len == len && !std::memcmp(e.str, str, len) ? e.token : 0;\n"
+                << "    }\n"
+                << "}\n\n"
+                << "#endif\n";
+            if (!out) {
+                std::fprintf(stderr, "kwgen: can't write %s\n", argv[2]);
+                return 1;
+            }
+
+            return 0;
+        }
+    }
+
+    std::fprintf(stderr, "kwgen: no perfect hash found\n");
+    return 1;
+}
@@ -2,35 +2,79 @@
 
 #include <string>
 #include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <memory>
 #include "libop/op.h"
 
-#include "parser.h"
+#include "driver.h"
+#include "server.h"
+#include "cache.h"
 #include "exception.h"
-#include "io.h"
 
 
 using namespace kwik;
 
 int main(int argc, char** argv) {
     std::vector<std::string> args {argv, argv + argc};
-    if (args.size() < 2) {
-        op::printf("Usage: {} <file>\n", args[0]);
+    DriverOptions opts;
+    unsigned jobs = 0;
+    std::string server_socket, client_socket, cache_dir;
+    uint64_t cache_size = 256;
+    bool cache_stats = false;
+    std::vector<std::string> files;
+
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "--prelex") {
+            opts.mode = ParseMode::PRELEXED;
+        } else if (args[i] == "-j" && i + 1 < args.size()) {
+            jobs = std::atoi(args[++i].c_str());
+        } else if (args[i].size() > 2 && args[i].compare(0, 2, "-j") == 0) {
+            jobs = std::atoi(args[i].c_str() + 2);
+        } else if (args[i] == "--server" && i + 1 < args.size()) {
+            server_socket = args[++i];
+        } else if (args[i] == "--client" && i + 1 < args.size()) {
+            client_socket = args[++i];
+        } else if (args[i] == "--cache" && i + 1 < args.size()) {
+            cache_dir = args[++i];
+        } else if (args[i] == "--cache-size" && i + 1 < args.size()) {
+            cache_size = std::strtoull(args[++i].c_str(), nullptr, 10);
+        } else if (args[i] == "--max-nesting" && i + 1 < args.size()) {
+            opts.max_nesting = std::strtoul(args[++i].c_str(), nullptr, 10);
+        } else if (args[i] == "--cache-stats") {
+            cache_stats = true;
+        } else files.push_back(args[i]);
+    }
+
+    // The server always parses incrementally, without the on-disk cache.
+    bool server = !server_socket.empty();
+    bool client = !client_socket.empty();
+    bool prelex = opts.mode == ParseMode::PRELEXED;
+    if ((server ? !files.empty() || client : files.empty()) || ((server || client) && (prelex || !cache_dir.empty()))) {
+        op::printf("Usage: {} [--prelex] [-j N] [--max-nesting N] [--cache <dir>] [--cache-size <MiB>] [--cache-stats] <file>...\n", args[0]);
+        op::printf("       {} [-j N] [--max-nesting N] --client <socket> <file>...\n", args[0]);
+        op::printf("       {} [-j N] --server <socket>\n", args[0]);
         return 1;
     }
 
-    try {
-        Source src = args[1] == "-" ? read_stdin() : read_file(args[1]);
-        parse(src);
-        return 0;
-    } catch (const CompilationError& e) {
-        op::print(e.what());
-    } catch (const EncodingError& e) {
-        op::print(e.what());
-    } catch (const FilesystemError& e) {
-        op::printf("error: {}: {}\n", args[1], e.what());
-    } catch (const InternalCompilerError& e) {
-        op::printf("internal compiler error: {}: {}\n", args[1], e.what());
+    // The client leaves the default number of jobs to the server.
+    if (client) return run_client(client_socket, files, jobs, opts.max_nesting);
+
+    opts.jobs = jobs ? jobs : std::max(1u, std::thread::hardware_concurrency());
+    std::unique_ptr<ParseCache> cache;
+    if (!cache_dir.empty()) {
+        try {
+            cache.reset(new ParseCache(cache_dir, cache_size << 20));
+        } catch (const FilesystemError& e) {
+            op::printf("error: {}\n", e.what());
+            return 1;
+        }
+
+        opts.cache = cache.get();
     }
 
-    return 1;
+    if (server) return run_server(server_socket, opts);
+    bool ok = compile_files(files, opts, [](const std::string& text) { op::printf("{}", text); });
+    if (cache && cache_stats) op::printf("Cache: {} hit(s), {} miss(es).\n", cache->hits(), cache->misses());
+    return ok ? 0 : 1;
 }
@@ -1,30 +1,73 @@
 #include "precompile.h"
 
-#include <set>
 #include <string>
 #include <array>
-#include <unordered_map>
+#include <cmath>
+
+#include "utf8cpp/utf8.h"
 
 #include "lexer.h"
 #include "exception.h"
 #include "grammar.h"
 #include "parser.h"
 #include "asciitype.h"
+#include "symbol.h"
+#include "keywords.h"
+#include "scan.h"
+#include "floatconv.h"
 
 
 
 
 
-static const std::unordered_map<std::string, int> keywords = {
-    {"let", KWIK_TOK_LET},
-    {"return", KWIK_TOK_RETURN}
-};
+// Returns 255 for anything that isn't a digit in any base.
+static inline int digit_value(char c) {
+    if (kwik::aisdigit(c)) return c - '0';
+    if (kwik::ainrange(c | 32, 'a', 6)) return (c | 32) - 'a' + 10;
+    return 255;
+}
 
-static const std::set<std::string> int_suffixes_set = {
-    "i8", "i16", "i32", "i64",
-    "u8", "u16", "u32", "u64",
-    "i"
-};
+// Returns NumSuffix::NONE if str isn't a valid suffix.
+static kwik::NumSuffix match_num_suffix(const char* str, size_t len) {
+    using S = kwik::NumSuffix;
+    if (len == 1) return str[0] == 'i' ? S::I : S::NONE;
+    if (len > 3 || str[1] == '0') return S::NONE;
+
+    int bits = 0;
+    for (size_t i = 1; i < len; ++i) {
+        if (!kwik::aisdigit(str[i])) return S::NONE;
+        bits = 10*bits + str[i] - '0';
+    }
+
+    switch (str[0]) {
+    case 'i':
+        switch (bits) { case 8: return S::I8; case 16: return S::I16; case 32: return S::I32; case 64: return S::I64; }
+        break;
+    case 'u':
+        switch (bits) { case 8: return S::U8; case 16: return S::U16; case 32: return S::U32; case 64: return S::U64; }
+        break;
+    case 'f':
+        switch (bits) { case 32: return S::F32; case 64: return S::F64; }
+        break;
+    }
+
+    return S::NONE;
+}
+
+// The largest value an integer literal with the given suffix may have.
+static uint64_t max_int_value(kwik::NumSuffix suffix) {
+    using S = kwik::NumSuffix;
+    switch (suffix) {
+    case S::I8: return INT8_MAX;
+    case S::I16: return INT16_MAX;
+    case S::I32: return INT32_MAX;
+    case S::I64: return INT64_MAX;
+    case S::U8: return UINT8_MAX;
+    case S::U16: return UINT16_MAX;
+    case S::U32: return UINT32_MAX;
+    default: return UINT64_MAX;
+    }
+}
 
 
 static std::array<unsigned char, 128> make_simple_tok_table() {
@@ -39,7 +82,7 @@ static std::array<unsigned char, 128> make_simple_tok_table() {
     return simple_tok_table;
 }
     
-static auto simple_tok_table = make_simple_tok_table();
+static const auto simple_tok_table = make_simple_tok_table();
 
 enum class LexerJumpIndex : unsigned char {
     ERROR = 0,
@@ -51,11 +94,15 @@ enum class LexerJumpIndex : unsigned char {
     ALPHA,
     DOT,
     SIMPLE_TOK,
+    OPEN_PAREN,
+    CLOSE_PAREN,
+    NON_ASCII,
+    NUM_JUMP_INDICES
 };
 
-static std::array<LexerJumpIndex, 128> make_jump_table() {
+static std::array<LexerJumpIndex, 256> make_jump_table() {
     using I = LexerJumpIndex;
-    std::array<LexerJumpIndex, 128> jump_table;
+    std::array<LexerJumpIndex, 256> jump_table;
 
     for (int c = 0; c < 128; ++c) {
         if (simple_tok_table[c]) jump_table[c] = I::SIMPLE_TOK;
@@ -64,145 +111,250 @@ static std::array<LexerJumpIndex, 128> make_jump_table() {
         else jump_table[c] = I::ERROR;
     }
 
+    for (int c = 128; c < 256; ++c) jump_table[c] = I::NON_ASCII;
+
     jump_table[U'_'] = I::ALPHA;
     jump_table[0] = I::NULL_EOF;
     jump_table[U' '] = I::SPACE;
     jump_table[U'\n'] = I::NEWLINE;
     jump_table[U'#'] = I::COMMENT;
     jump_table[U'.'] = I::DOT;
+    jump_table[U'('] = I::OPEN_PAREN;
+    jump_table[U')'] = I::CLOSE_PAREN;
     return jump_table;
 }
 
-static auto jump_table = make_jump_table();
+static const auto jump_table = make_jump_table();
+
+// GCC and Clang support taking the address of a label, which lets get_token
+// jump through the jump table straight to a handler, with a separate indirect
+// branch at the end of every handler instead of one shared switch. Define
+// KWIK_NO_COMPUTED_GOTO to use the portable switch instead.
+#if defined(__GNUC__) && !defined(KWIK_NO_COMPUTED_GOTO)
+    #define KWIK_COMPUTED_GOTO
+#endif
 
 
 
 
 namespace kwik {
-    Lexer::Lexer(ParseState& s)
-        : s(s), line(1), col(1), it(s.src.code.data()) { }
+    void TokenBuffer::push(const Token& token) {
+        assert(token.type >= 0 && token.type < 256);
+        types.push_back(token.type);
+        locs.push_back(token.loc);
+        lens.push_back(token.len);
+        if (token.type == KWIK_TOK_NAME) {
+            payloads.push_back(token.sym);
+        } else if (token.type == KWIK_TOK_NUM) {
+            payloads.push_back(numbers.size());
+            numbers.push_back(token.number);
+        } else payloads.push_back(0);
+    }
+
+    Token TokenBuffer::get(size_t i) const {
+        Token token = {types[i], locs[i], lens[i]};
+        if (token.type == KWIK_TOK_NAME) token.sym = payloads[i];
+        else if (token.type == KWIK_TOK_NUM) token.number = numbers[payloads[i]];
+        return token;
+    }
+
+
+    Lexer::Lexer(const Source& src, size_t offset)
+        : src(src), pos(src.code.get() + offset), paren_depth(0) { }
 
-    SourceRef Lexer::getref(size_t line, size_t col) {
-        return SourceRef{s.src, line, col};
+    SourceLoc Lexer::getloc(const char* at) {
+        return src.loc(at - src.code.get());
     }
 
-    void Lexer::throw_unexpected_char(uint32_t c, size_t line, size_t col) {
+    Token Lexer::make_token(int type, const char* start) {
+        return {type, getloc(start), uint32_t(pos - start)};
+    }
+
+    void Lexer::throw_unexpected_char(uint32_t c, const char* at) {
         std::string errmsg = "unexpected character: '";
         utf8::append(c, std::back_inserter(errmsg));
         errmsg += "'";
-        throw SyntaxError(errmsg, getref(line, col));
+        throw SyntaxError(errmsg, getloc(at));
     }
 
     Token Lexer::lex_num() {
         int base = 10;
         bool floating = false;
-        size_t startcol = col;
+        const char* start = pos;
 
-        auto n = *std::next(it);
-        if (*it == U'0' && (n == U'b' || n == U'o' || n == U'x')) {
-            std::advance(it, 2);
-            col += 2;
+        char n = pos[1];
+        if (pos[0] == '0' && (n == 'b' || n == 'o' || n == 'x')) {
+            pos += 2;
             switch (n) {
-            case U'b': base =  2; break;
-            case U'o': base =  8; break;
-            case U'x': base = 16; break;
+            case 'b': base =  2; break;
+            case 'o': base =  8; break;
+            case 'x': base = 16; break;
             }
         }
 
-        std::string value;
-        if (base == 10) {
-            while (aisdigit(*it)) { value += *it++; ++col; }
-        } else if (base == 2) {
-            while (aisbdigit(*it)) { value += *it++; ++col; }
-        } else if (base == 8) {
-            while (aisodigit(*it)) { value += *it++; ++col; }
-        } else if (base == 16) {
-            while (aisxdigit(*it)) { value += *it++; ++col; }
+        // Overflow only matters if this turns out to be an integer.
+        uint64_t value = 0;
+        bool overflow = false;
+        for (int d; (d = digit_value(*pos)) < base; ++pos) {
+            overflow |= value > (UINT64_MAX - d) / base;
+            value = value * base + d;
         }
 
         if (base == 10) {
-            if (*it == U'.') {
+            if (*pos == '.') {
                 floating = true;
-                value += *it++; ++col;
+                ++pos;
             }
             
-            while (aisdigit(*it)) { value += *it++; ++col; }
+            while (aisdigit(*pos)) ++pos;
         }
 
-        std::string suffix;
-        size_t suffix_col = col;
-        while (aisalnum(*it)) { suffix += *it++; ++col; }
+        const char* suffix_start = pos;
+        while (aisalnum(*pos)) ++pos;
+        size_t suffix_len = pos - suffix_start;
+        NumSuffix suffix = NumSuffix::NONE;
 
-        if (suffix.size()) {
-            if (suffix == "f32" || suffix == "f64") {
+        if (suffix_len) {
+            suffix = match_num_suffix(suffix_start, suffix_len);
+            auto suffix_str = [&] { return std::string(suffix_start, suffix_len); };
+            if (suffix == NumSuffix::F32 || suffix == NumSuffix::F64) {
                 if (base != 10) {
-                    throw SyntaxError("invalid base for suffix '" + suffix + "'", getref(line, startcol));
+                    throw SyntaxError("invalid base for suffix '" + suffix_str() + "'", getloc(start));
                 }
                 floating = true;
             } else if (floating) {
-                throw SyntaxError("invalid float suffix '" + suffix + "'", getref(line, suffix_col));
-            } else if (!int_suffixes_set.count(suffix)) {
-                throw SyntaxError("invalid integer suffix '" + suffix + "'", getref(line, suffix_col));
+                throw SyntaxError("invalid float suffix '" + suffix_str() + "'", getloc(suffix_start));
+            } else if (suffix == NumSuffix::NONE) {
+                throw SyntaxError("invalid integer suffix '" + suffix_str() + "'", getloc(suffix_start));
+            }
+        }
+
+        double fvalue = 0;
+        if (floating) {
+            if (suffix == NumSuffix::F32) fvalue = parse_f32(start, suffix_start);
+            else fvalue = parse_f64(start, suffix_start);
+            if (std::isinf(fvalue)) {
+                throw SyntaxError("float literal too large", getloc(start));
             }
         }
 
-        Token tok(KWIK_TOK_NUM, value + suffix, getref(line, startcol));
+        if (!floating && (overflow || value > max_int_value(suffix))) {
+            std::string errmsg = "integer literal too large";
+            if (suffix_len) errmsg += " for suffix '" + std::string(suffix_start, suffix_len) + "'";
+            throw SyntaxError(errmsg, getloc(start));
+        }
+
+        Token tok = make_token(KWIK_TOK_NUM, start);
+        if (floating) tok.number.fvalue = fvalue;
+        else tok.number.value = value;
         tok.number.base = base;
         tok.number.floating = floating;
-        tok.number.suffix_len = suffix.size();
+        tok.number.suffix = suffix;
         return tok;
     }
 
     Token Lexer::lex_ident() {
-        size_t startcol = col++;
-        std::string ident(1, *it++);
-        while (aisalnum(*it) || *it == U'_') { ident += *it++; ++col; }
+        const char* start = pos;
+        pos = skip_ident_chars(start + 1);
 
-        auto it = keywords.find(ident);
-        if (it == keywords.end()) return {KWIK_TOK_NAME, ident, getref(line, startcol)};
-        return {it->second, getref(line, startcol)};
+        size_t len = pos - start;
+        if (int keyword = match_keyword(start, len)) return make_token(keyword, start);
+
+        Token tok = make_token(KWIK_TOK_NAME, start);
+        tok.sym = symbols().intern(start, len);
+        return tok;
     }
 
+#ifdef KWIK_COMPUTED_GOTO
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpedantic"
+    #define KWIK_LEX_CASE(name) L_##name
+    #define KWIK_LEX_NEXT() do { start = pos; c = *pos; goto *labels[int(jump_table[c])]; } while (0)
+#else
+    #define KWIK_LEX_CASE(name) case I::name
+    #define KWIK_LEX_NEXT() continue
+#endif
+
     Token Lexer::get_token() {
+        using I = LexerJumpIndex;
+        const char* start;
+        unsigned char c;
+
+#ifdef KWIK_COMPUTED_GOTO
+        // Must be in the order of LexerJumpIndex.
+        static const void* const labels[] = {
+            &&L_ERROR, &&L_NULL_EOF, &&L_SPACE, &&L_NEWLINE, &&L_COMMENT, &&L_DIGIT,
+            &&L_ALPHA, &&L_DOT, &&L_SIMPLE_TOK, &&L_OPEN_PAREN, &&L_CLOSE_PAREN,
+            &&L_NON_ASCII
+        };
+        static_assert(sizeof(labels) / sizeof(*labels) == int(I::NUM_JUMP_INDICES),
+                      "label table out of sync with LexerJumpIndex");
+
+        KWIK_LEX_NEXT();
+#else
         while (true) {
-            size_t startcol = col;
-            uint32_t c = *it;
-            if (c >= 128) {
-                ++it; // Skip the bad character.
-                throw_unexpected_char(c, line, startcol);
-            }
-
-            // For performance it's important that the order here matches the order of
-            // the jump table defined above.
-            using I = LexerJumpIndex;
+            start = pos;
+            c = *pos;
             switch (jump_table[c]) {
-            case I::ERROR:
-                ++it; ++col;
-                throw_unexpected_char(c, line, startcol);
-            case I::NULL_EOF:
-                ++it; ++col;
-                return {0, getref(line, startcol)};
-            case I::SPACE:
-                ++it; ++col;
-                break;
-            case I::NEWLINE:
-                ++it; col = 1; ++line;
-                if (s.nested_paren == 0) return {KWIK_TOK_NL, getref(line-1, startcol)};
-                break;
-            case I::COMMENT:
-                do { ++it; ++col; } while (*it && *it != U'\n');
-                break;
-            case I::DIGIT:
+            case I::NUM_JUMP_INDICES: break;
+#endif
+            KWIK_LEX_CASE(ERROR):
+                ++pos;
+                throw_unexpected_char(c, start);
+            KWIK_LEX_CASE(NULL_EOF):
+                return make_token(0, start);
+            KWIK_LEX_CASE(SPACE):
+                pos = skip_spaces(pos + 1);
+                KWIK_LEX_NEXT();
+            KWIK_LEX_CASE(NEWLINE):
+                ++pos;
+                if (paren_depth == 0) return make_token(KWIK_TOK_NL, start);
+                KWIK_LEX_NEXT();
+            KWIK_LEX_CASE(COMMENT):
+                pos = skip_to_eol(pos + 1);
+                KWIK_LEX_NEXT();
+            KWIK_LEX_CASE(DIGIT):
                 return lex_num();
-            case I::ALPHA:
+            KWIK_LEX_CASE(ALPHA):
                 return lex_ident();
-            case I::DOT:
-                if (aisdigit(*std::next(it))) return lex_num();
-                ++it; ++col;
-                throw_unexpected_char(c, line, startcol);
-            case I::SIMPLE_TOK:
-                ++it; ++col;
-                return {simple_tok_table[c], getref(line, startcol)};
+            KWIK_LEX_CASE(DOT):
+                if (aisdigit(pos[1])) return lex_num();
+                ++pos;
+                throw_unexpected_char(c, start);
+            KWIK_LEX_CASE(SIMPLE_TOK):
+                ++pos;
+                return make_token(simple_tok_table[c], start);
+            KWIK_LEX_CASE(OPEN_PAREN):
+                ++pos;
+                ++paren_depth;
+                return make_token(KWIK_TOK_OPEN_PAREN, start);
+            KWIK_LEX_CASE(CLOSE_PAREN):
+                ++pos;
+                if (paren_depth > 0) --paren_depth;
+                return make_token(KWIK_TOK_CLOSE_PAREN, start);
+            KWIK_LEX_CASE(NON_ASCII):
+                // Decoding also skips the bad character.
+                throw_unexpected_char(utf8::unchecked::next(pos), start);
+#ifndef KWIK_COMPUTED_GOTO
+            }
+        }
+#endif
+    }
+
+#undef KWIK_LEX_CASE
+#undef KWIK_LEX_NEXT
+#ifdef KWIK_COMPUTED_GOTO
+    #pragma GCC diagnostic pop
+#endif
+
+    void Lexer::lex_all(TokenBuffer& tokens) {
+        while (true) {
+            try {
+                auto token = get_token();
+                tokens.push(token);
+                if (token.type == 0) break;
+            } catch (const CompilationError& e) {
+                tokens.errors.emplace_back(tokens.size(), std::unique_ptr<CompilationError>(e.clone()));
             }
         }
     }
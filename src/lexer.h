@@ -3,28 +3,57 @@
 
 #include <string>
 #include <memory>
-#include "utf8cpp/utf8.h"
 
-#include "parser.h"
 #include "token.h"
 #include "io.h"
+#include "exception.h"
 
 
 namespace kwik {
+    // The tokens of a whole source in struct-of-arrays form, so the parser can
+    // consume them in a tight loop. Names store their symbol as payload,
+    // numbers an index into numbers.
+    struct TokenBuffer {
+        std::vector<uint8_t> types;
+        std::vector<SourceLoc> locs;
+        std::vector<uint32_t> lens;
+        std::vector<uint32_t> payloads;
+        std::vector<Token::Number> numbers;
+
+        // Lexer errors, each with the index of the token following it.
+        std::vector<std::pair<size_t, std::unique_ptr<CompilationError>>> errors;
+
+        size_t size() const { return types.size(); }
+        void push(const Token& token);
+        Token get(size_t i) const;
+    };
+
     class Lexer {
     public:
-        Lexer(ParseState& s);
+        // Starts lexing at offset, which must be at the start of a line or
+        // right after a token, outside of parentheses.
+        Lexer(const Source& src, size_t offset = 0);
         Token get_token();
 
+        // Lexes everything up to and including the end of file token.
+        void lex_all(TokenBuffer& tokens);
+
     private:
-        SourceRef getref(size_t line, size_t col);
-        void throw_unexpected_char(uint32_t c, size_t line, size_t col);
+        SourceLoc getloc(const char* at);
+        Token make_token(int type, const char* start);
+        [[noreturn]] void throw_unexpected_char(uint32_t c, const char* at);
         Token lex_num();
         Token lex_ident();
 
-        ParseState& s;
-        size_t line, col;
-        utf8::unchecked::iterator<const char*> it;
+        const Source& src;
+
+        // The grammar is pure ASCII, so we walk raw bytes and only decode
+        // UTF-8 (which make_source guarantees to be valid) to report errors.
+        const char* pos;
+
+        // Newlines inside parentheses don't end statements, so the lexer
+        // doesn't emit them.
+        int paren_depth;
     };
 }
 
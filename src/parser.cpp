@@ -3,41 +3,80 @@
 #include "token.h"
 #include "parser.h"
 #include "lexer.h"
+#include "grammar.h"
 
 void* KwikParseAlloc(void* (*alloc_proc)(size_t));
-void KwikParse(void* state, int token_id, kwik::Token* token_data, kwik::ParseState* s);
+void KwikParse(void* state, int token_id, kwik::Token token_data, kwik::ParseState* s);
 void KwikParseFree(void*, void(*free_proc)(void*));
 
 
 
 namespace kwik {
-    void parse(const Source& src) {
-        auto parser = KwikParseAlloc(malloc);
-        OP_SCOPE_EXIT { KwikParseFree(parser, free); };
+    bool ParseState::track_nesting(const Token& token) {
+        if (token.type == KWIK_TOK_OPEN_BRACE || token.type == KWIK_TOK_OPEN_PAREN) {
+            if (nesting == max_nesting) {
+                auto msg = op::format("nesting too deep, the limit is {} levels", max_nesting);
+                errors.emplace_back(new SyntaxError(msg, token.loc));
+                return false;
+            }
 
-        auto state = ParseState{src};
-        auto lex = Lexer{state};
+            ++nesting;
+        } else if ((token.type == KWIK_TOK_CLOSE_BRACE || token.type == KWIK_TOK_CLOSE_PAREN) && nesting > 0) {
+            --nesting;
+        }
 
+        return true;
+    }
+
+    static void parse_streaming(void* parser, ParseState& state) {
+        Lexer lex{state.src};
         while (true) {
             try {
                 auto token = lex.get_token();
-                KwikParse(parser, token.type, new Token(token), &state);
+                if (!state.track_nesting(token)) break;
+                KwikParse(parser, token.type, token, &state);
                 if (token.type == 0) break;
             } catch (const CompilationError& e) {
                 state.errors.emplace_back(e.clone());
             }
         }
+    }
+
+    static void parse_prelexed(void* parser, ParseState& state) {
+        TokenBuffer tokens;
+        Lexer{state.src}.lex_all(tokens);
+
+        // Lexer errors are interleaved so diagnostics come out in the same
+        // order as when streaming.
+        auto error = tokens.errors.begin();
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            for (; error != tokens.errors.end() && error->first == i; ++error) {
+                state.errors.push_back(std::move(error->second));
+            }
+
+            Token token = tokens.get(i);
+            if (!state.track_nesting(token)) break;
+            KwikParse(parser, token.type, token, &state);
+        }
+    }
 
-        ast::Environment global_env(nullptr);
+    ParseResult parse(const Source& src, ParseMode mode, AstArena* arena, uint32_t max_nesting) {
+        auto parser = KwikParseAlloc(malloc);
+        OP_SCOPE_EXIT { KwikParseFree(parser, free); };
+
+        AstArena local_arena;
+        ParseState state{src, arena ? *arena : local_arena, max_nesting};
+        if (mode == ParseMode::PRELEXED) parse_prelexed(parser, state);
+        else parse_streaming(parser, state);
+
+        // There is no program if parsing failed.
+        ast::Environment global_env;
         try {
-            state.program->check(global_env);
+            if (state.program) ast::check(state.program, global_env);
         } catch (const CompilationError& e) {
             state.errors.emplace_back(e.clone());
         }
 
-        op::printf("Finished parse with {} error(s).\n", state.errors.size());
-        for (auto& error : state.errors) {
-            op::print(error->what());
-        }
+        return {std::move(state.errors), arena ? state.program : nullptr};
     }
 }
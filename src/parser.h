@@ -4,13 +4,22 @@
 #include "ast.h"
 #include "io.h"
 #include "exception.h"
+#include "arena.h"
 
 
 
 namespace kwik {
+    // How deeply braces and parentheses may nest by default.
+    const uint32_t DEFAULT_MAX_NESTING = 100000;
+
     struct ParseState {
-        ParseState(const Source& src)
-            : src(src), nested_paren(0), program(nullptr) { }
+        ParseState(const Source& src, AstArena& arena, uint32_t max_nesting = DEFAULT_MAX_NESTING)
+            : src(src), arena(arena), program(nullptr), max_nesting(max_nesting), nesting(0) { }
+
+        // Call on every token before parsing it. Returns false, with an error
+        // added, if the token nests deeper than max_nesting, after which the
+        // parse must stop.
+        bool track_nesting(const Token& token);
 
         // void error_with_context(const std::string& msg, int line, int col) {
         //     assert(line - 1 >= 0);
@@ -24,12 +33,38 @@ namespace kwik {
         // }
 
         const Source& src;
-        int nested_paren;
-        std::unique_ptr<ast::CompoundStmt> program;
+        AstArena& arena;
+        ast::CompoundStmt* program;
         std::vector<std::unique_ptr<CompilationError>> errors;
+        uint32_t max_nesting;
+        uint32_t nesting;
+    };
+
+    enum class ParseMode {
+        // Lex and parse token by token.
+        STREAMING,
+        // Lex the whole source into a TokenBuffer first, then parse it.
+        PRELEXED,
+    };
+
+    struct ParseResult {
+        ParseResult() : program(nullptr) { }
+        ParseResult(std::vector<std::unique_ptr<CompilationError>> errors, ast::CompoundStmt* program)
+            : errors(std::move(errors)), program(program) { }
+
+        std::vector<std::unique_ptr<CompilationError>> errors;
+
+        // The program, if there is one and it was built in an arena given to
+        // parse.
+        ast::CompoundStmt* program;
     };
 
-    void parse(const Source& src);
+    // Parses and checks src. Everything a parse allocates is its own, so
+    // different sources can be parsed concurrently. The AST goes into arena
+    // if given, which must not be used by anything else during the parse.
+    // Programs nested deeper than max_nesting are rejected with an error.
+    ParseResult parse(const Source& src, ParseMode mode = ParseMode::STREAMING, AstArena* arena = nullptr,
+                      uint32_t max_nesting = DEFAULT_MAX_NESTING);
 }
 
 
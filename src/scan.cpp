@@ -0,0 +1,383 @@
+#include "precompile.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define KWIK_SCAN_X86
+    #include <immintrin.h>
+#endif
+
+#include "scan.h"
+#include "asciitype.h"
+
+
+namespace kwik {
+    Utf8Scan scan_utf8_scalar(const char* begin, const char* end) {
+        Utf8Scan result = {true, false, false};
+
+        auto p = reinterpret_cast<const unsigned char*>(begin);
+        auto e = reinterpret_cast<const unsigned char*>(end);
+        while (p < e) {
+            unsigned char c = *p;
+            if (c < 0x80) {
+                result.has_cr |= c == '\r';
+                result.has_nul |= c == 0;
+                ++p;
+                continue;
+            }
+
+            // Valid ranges for the second byte of a sequence, see table 3-7 of
+            // the Unicode standard. This rejects overlong forms and surrogates.
+            int len;
+            unsigned char lo = 0x80, hi = 0xbf;
+            if      (c >= 0xc2 && c <= 0xdf) len = 2;
+            else if (c == 0xe0) { len = 3; lo = 0xa0; }
+            else if (c == 0xed) { len = 3; hi = 0x9f; }
+            else if (c >= 0xe1 && c <= 0xef) len = 3;
+            else if (c == 0xf0) { len = 4; lo = 0x90; }
+            else if (c == 0xf4) { len = 4; hi = 0x8f; }
+            else if (c >= 0xf1 && c <= 0xf3) len = 4;
+            else { result.valid = false; break; }
+
+            bool ok = e - p >= len && p[1] >= lo && p[1] <= hi;
+            for (int i = 2; ok && i < len; ++i) ok = (p[i] & 0xc0) == 0x80;
+            if (!ok) { result.valid = false; break; }
+
+            p += len;
+        }
+
+        return result;
+    }
+
+
+#ifdef KWIK_SCAN_X86
+    // UTF-8 validation using the lookup algorithm from Keiser and Lemire,
+    // "Validating UTF-8 In Less Than One Instruction Per Byte". Every byte is
+    // classified together with its predecessor using three 16-entry tables,
+    // each error class being a bit that survives only if all three agree.
+    enum : uint8_t {
+        TOO_SHORT   = 1 << 0, // 11______ 0_______ or 11______ 11______
+        TOO_LONG    = 1 << 1, // 0_______ 10______
+        OVERLONG_3  = 1 << 2, // 11100000 100_____
+        TOO_LARGE   = 1 << 3, // 11110100 1001____ and larger
+        SURROGATE   = 1 << 4, // 11101101 101_____
+        OVERLONG_2  = 1 << 5, // 1100000_ 10______
+        TOO_LARGE_1000 = 1 << 6, // 11110101 1000____ and larger
+        OVERLONG_4  = 1 << 6, // 11110000 1000____
+        TWO_CONTS   = 1 << 7, // 10______ 10______
+        CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS,
+    };
+
+    alignas(16) static const uint8_t byte_1_high_table[16] = {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+    };
+
+    alignas(16) static const uint8_t byte_1_low_table[16] = {
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+    };
+
+    alignas(16) static const uint8_t byte_2_high_table[16] = {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    };
+
+    // A block ending in these lead bytes continues into the next block.
+    alignas(32) static const uint8_t incomplete_max[32] = {
+        255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+    };
+
+
+    // The two implementations below are the same algorithm at different
+    // vector widths. The tail is padded with spaces, which are neither carriage
+    // returns nor null bytes and terminate any incomplete sequence.
+    #define KWIK_SSE42 __attribute__((target("sse4.2")))
+    KWIK_SSE42 static inline __m128i shr4_sse42(__m128i v) {
+        return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+    }
+
+    KWIK_SSE42 static Utf8Scan scan_utf8_sse42(const char* begin, const char* end) {
+        const __m128i byte_1_high = _mm_load_si128((const __m128i*) byte_1_high_table);
+        const __m128i byte_1_low = _mm_load_si128((const __m128i*) byte_1_low_table);
+        const __m128i byte_2_high = _mm_load_si128((const __m128i*) byte_2_high_table);
+        const __m128i max_incomplete = _mm_load_si128((const __m128i*) (incomplete_max + 16));
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i zero = _mm_setzero_si128();
+
+        __m128i error = zero, prev_input = zero, prev_incomplete = zero;
+        __m128i crs = zero, nuls = zero;
+        alignas(16) char tail[16];
+        for (const char* p = begin; p < end; p += 16) {
+            __m128i input;
+            if (end - p >= 16) input = _mm_loadu_si128((const __m128i*) p);
+            else {
+                std::memset(tail, ' ', 16);
+                std::memcpy(tail, p, end - p);
+                input = _mm_load_si128((const __m128i*) tail);
+            }
+
+            crs = _mm_or_si128(crs, _mm_cmpeq_epi8(input, cr));
+            nuls = _mm_or_si128(nuls, _mm_cmpeq_epi8(input, zero));
+            if (!_mm_movemask_epi8(input)) {
+                error = _mm_or_si128(error, prev_incomplete);
+            } else {
+                __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+                __m128i sc = _mm_and_si128(_mm_and_si128(
+                    _mm_shuffle_epi8(byte_1_high, shr4_sse42(prev1)),
+                    _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, _mm_set1_epi8(0x0f)))),
+                    _mm_shuffle_epi8(byte_2_high, shr4_sse42(input)));
+
+                // Continuation bytes must appear exactly where a preceding
+                // three or four byte lead byte demands them.
+                __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+                __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+                __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                                              _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+                __m128i must23_80 = _mm_and_si128(must23, _mm_set1_epi8(char(0x80)));
+                error = _mm_or_si128(error, _mm_xor_si128(must23_80, sc));
+                prev_incomplete = _mm_subs_epu8(input, max_incomplete);
+            }
+
+            prev_input = input;
+        }
+
+        error = _mm_or_si128(error, prev_incomplete);
+        return {bool(_mm_testz_si128(error, error)),
+                !_mm_testz_si128(crs, crs), !_mm_testz_si128(nuls, nuls)};
+    }
+    #undef KWIK_SSE42
+
+    #define KWIK_AVX2 __attribute__((target("avx2")))
+    KWIK_AVX2 static inline __m256i shr4_avx2(__m256i v) {
+        return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+    }
+
+    KWIK_AVX2 static inline __m256i load_table_avx2(const uint8_t* table) {
+        return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*) table));
+    }
+
+    KWIK_AVX2 static Utf8Scan scan_utf8_avx2(const char* begin, const char* end) {
+        const __m256i byte_1_high = load_table_avx2(byte_1_high_table);
+        const __m256i byte_1_low = load_table_avx2(byte_1_low_table);
+        const __m256i byte_2_high = load_table_avx2(byte_2_high_table);
+        const __m256i max_incomplete = _mm256_load_si256((const __m256i*) incomplete_max);
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i zero = _mm256_setzero_si256();
+
+        __m256i error = zero, prev_input = zero, prev_incomplete = zero;
+        __m256i crs = zero, nuls = zero;
+        alignas(32) char tail[32];
+        for (const char* p = begin; p < end; p += 32) {
+            __m256i input;
+            if (end - p >= 32) input = _mm256_loadu_si256((const __m256i*) p);
+            else {
+                std::memset(tail, ' ', 32);
+                std::memcpy(tail, p, end - p);
+                input = _mm256_load_si256((const __m256i*) tail);
+            }
+
+            crs = _mm256_or_si256(crs, _mm256_cmpeq_epi8(input, cr));
+            nuls = _mm256_or_si256(nuls, _mm256_cmpeq_epi8(input, zero));
+            if (!_mm256_movemask_epi8(input)) {
+                error = _mm256_or_si256(error, prev_incomplete);
+            } else {
+                // alignr works per 128-bit lane, so first bring the upper lane
+                // of the previous block next to the lower lane of this one.
+                __m256i joined = _mm256_permute2x128_si256(prev_input, input, 0x21);
+                __m256i prev1 = _mm256_alignr_epi8(input, joined, 15);
+                __m256i sc = _mm256_and_si256(_mm256_and_si256(
+                    _mm256_shuffle_epi8(byte_1_high, shr4_avx2(prev1)),
+                    _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+                    _mm256_shuffle_epi8(byte_2_high, shr4_avx2(input)));
+
+                __m256i prev2 = _mm256_alignr_epi8(input, joined, 14);
+                __m256i prev3 = _mm256_alignr_epi8(input, joined, 13);
+                __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+                                                 _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+                __m256i must23_80 = _mm256_and_si256(must23, _mm256_set1_epi8(char(0x80)));
+                error = _mm256_or_si256(error, _mm256_xor_si256(must23_80, sc));
+                prev_incomplete = _mm256_subs_epu8(input, max_incomplete);
+            }
+
+            prev_input = input;
+        }
+
+        error = _mm256_or_si256(error, prev_incomplete);
+        return {bool(_mm256_testz_si256(error, error)),
+                !_mm256_testz_si256(crs, crs), !_mm256_testz_si256(nuls, nuls)};
+    }
+    #undef KWIK_AVX2
+#endif
+
+
+    static const char* skip_spaces_scalar(const char* p) {
+        while (*p == ' ') ++p;
+        return p;
+    }
+
+    static const char* skip_to_eol_scalar(const char* p) {
+        while (*p && *p != '\n') ++p;
+        return p;
+    }
+
+    static const char* skip_ident_chars_scalar(const char* p) {
+        while (aisalnum(*p) || *p == '_') ++p;
+        return p;
+    }
+
+#ifdef KWIK_SCAN_X86
+    // Each loop stops at the first block where mask, which has a bit set for
+    // every byte that ends the run, is nonzero.
+    static const char* skip_spaces_sse2(const char* p) {
+        const __m128i space = _mm_set1_epi8(' ');
+        while (true) {
+            __m128i v = _mm_loadu_si128((const __m128i*) p);
+            unsigned mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, space)) & 0xffff;
+            if (mask) return p + __builtin_ctz(mask);
+            p += 16;
+        }
+    }
+
+    static const char* skip_to_eol_sse2(const char* p) {
+        const __m128i nl = _mm_set1_epi8('\n');
+        const __m128i zero = _mm_setzero_si128();
+        while (true) {
+            __m128i v = _mm_loadu_si128((const __m128i*) p);
+            unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, zero)));
+            if (mask) return p + __builtin_ctz(mask);
+            p += 16;
+        }
+    }
+
+    // Unsigned range check lo <= v <= hi for every byte.
+    static inline __m128i in_range_sse2(__m128i v, char lo, char hi) {
+        __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(hi - lo)), t);
+    }
+
+    static const char* skip_ident_chars_sse2(const char* p) {
+        while (true) {
+            __m128i v = _mm_loadu_si128((const __m128i*) p);
+            __m128i alpha = in_range_sse2(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+            __m128i digit = in_range_sse2(v, '0', '9');
+            __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+            __m128i ident = _mm_or_si128(_mm_or_si128(alpha, digit), under);
+            unsigned mask = ~_mm_movemask_epi8(ident) & 0xffff;
+            if (mask) return p + __builtin_ctz(mask);
+            p += 16;
+        }
+    }
+
+    #define KWIK_AVX2 __attribute__((target("avx2")))
+    KWIK_AVX2 static const char* skip_spaces_avx2(const char* p) {
+        const __m256i space = _mm256_set1_epi8(' ');
+        while (true) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) p);
+            unsigned mask = ~unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, space)));
+            if (mask) return p + __builtin_ctz(mask);
+            p += 32;
+        }
+    }
+
+    KWIK_AVX2 static const char* skip_to_eol_avx2(const char* p) {
+        const __m256i nl = _mm256_set1_epi8('\n');
+        const __m256i zero = _mm256_setzero_si256();
+        while (true) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) p);
+            unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, nl),
+                                                                 _mm256_cmpeq_epi8(v, zero)));
+            if (mask) return p + __builtin_ctz(mask);
+            p += 32;
+        }
+    }
+
+    KWIK_AVX2 static inline __m256i in_range_avx2(__m256i v, char lo, char hi) {
+        __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(hi - lo)), t);
+    }
+
+    KWIK_AVX2 static const char* skip_ident_chars_avx2(const char* p) {
+        while (true) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) p);
+            __m256i alpha = in_range_avx2(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+            __m256i digit = in_range_avx2(v, '0', '9');
+            __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+            __m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit), under);
+            unsigned mask = ~unsigned(_mm256_movemask_epi8(ident));
+            if (mask) return p + __builtin_ctz(mask);
+            p += 32;
+        }
+    }
+    #undef KWIK_AVX2
+#endif
+
+
+    using SkipFn = const char* (*)(const char*);
+    struct SkipFns {
+        SkipFn spaces;
+        SkipFn to_eol;
+        SkipFn ident_chars;
+    };
+
+    static SkipFns select_skip_fns() {
+#ifdef KWIK_SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return {skip_spaces_avx2, skip_to_eol_avx2, skip_ident_chars_avx2};
+        }
+        return {skip_spaces_sse2, skip_to_eol_sse2, skip_ident_chars_sse2};
+#endif
+        return {skip_spaces_scalar, skip_to_eol_scalar, skip_ident_chars_scalar};
+    }
+
+    static const SkipFns skip_fns = select_skip_fns();
+
+    const char* skip_spaces(const char* p) { return skip_fns.spaces(p); }
+    const char* skip_to_eol(const char* p) { return skip_fns.to_eol(p); }
+    const char* skip_ident_chars(const char* p) { return skip_fns.ident_chars(p); }
+
+
+    using ScanUtf8Fn = Utf8Scan (*)(const char*, const char*);
+    static ScanUtf8Fn select_scan_utf8() {
+#ifdef KWIK_SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return scan_utf8_avx2;
+        if (__builtin_cpu_supports("sse4.2")) return scan_utf8_sse42;
+#endif
+        return scan_utf8_scalar;
+    }
+
+    static const ScanUtf8Fn scan_utf8_impl = select_scan_utf8();
+
+    Utf8Scan scan_utf8(const char* begin, const char* end) {
+        return scan_utf8_impl(begin, end);
+    }
+}
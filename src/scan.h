@@ -0,0 +1,34 @@
+#ifndef KWIK_SCAN_H
+#define KWIK_SCAN_H
+
+// Vectorized byte scanning routines. Each routine has a scalar fallback and
+// picks the widest instruction set the CPU supports at runtime.
+
+namespace kwik {
+    struct Utf8Scan {
+        bool valid;
+        bool has_cr;
+        bool has_nul;
+    };
+
+    // Validates [begin, end) as UTF-8 and reports whether it contains
+    // carriage returns or null bytes. The latter two are only meaningful if
+    // the input is valid.
+    Utf8Scan scan_utf8(const char* begin, const char* end);
+    Utf8Scan scan_utf8_scalar(const char* begin, const char* end);
+
+    // Lexer fast paths. These read whole vectors (up to 32 bytes) past their
+    // result, which is safe on Source::code: every run they skip ends at the
+    // latest on the terminating null bytes, of which there are enough.
+
+    // Returns the first byte at or after p that isn't a space.
+    const char* skip_spaces(const char* p);
+
+    // Returns the first newline or null byte at or after p.
+    const char* skip_to_eol(const char* p);
+
+    // Returns the first byte at or after p not in [A-Za-z0-9_].
+    const char* skip_ident_chars(const char* p);
+}
+
+#endif
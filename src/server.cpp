@@ -0,0 +1,374 @@
+#include "precompile.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "libop/op.h"
+
+#include "server.h"
+#include "incremental.h"
+#include "exception.h"
+
+
+// Every message is a 32-bit length in native byte order followed by that many
+// bytes. A request holds the job count, nesting limit, the client's working
+// directory and the files, a response whether all files compiled followed by
+// the output.
+namespace kwik {
+    static const uint32_t MAX_MESSAGE_SIZE = 1 << 30;
+    static const unsigned MAX_CONNECTIONS = 64;
+    static const time_t CLIENT_TIMEOUT = 60; // Seconds.
+
+    struct MessageWriter {
+        std::string data;
+
+        void u32(uint32_t x) { data.append(reinterpret_cast<const char*>(&x), sizeof(x)); }
+        void str(const std::string& s) { u32(s.size()); data += s; }
+    };
+
+    struct MessageReader {
+        const std::string& data;
+        size_t pos;
+
+        bool u32(uint32_t& x) {
+            if (data.size() - pos < sizeof(x)) return false;
+            std::memcpy(&x, data.data() + pos, sizeof(x));
+            pos += sizeof(x);
+            return true;
+        }
+
+        bool str(std::string& s) {
+            uint32_t len;
+            if (!u32(len) || data.size() - pos < len) return false;
+            s.assign(data, pos, len);
+            pos += len;
+            return true;
+        }
+    };
+
+    static bool write_all(int fd, const char* buf, size_t len) {
+        while (len) {
+            ssize_t n = write(fd, buf, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buf += n;
+            len -= n;
+        }
+
+        return true;
+    }
+
+    static bool read_all(int fd, char* buf, size_t len) {
+        while (len) {
+            ssize_t n = read(fd, buf, len);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buf += n;
+            len -= n;
+        }
+
+        return true;
+    }
+
+    static bool send_message(int fd, const std::string& msg) {
+        uint32_t len = msg.size();
+        return write_all(fd, reinterpret_cast<const char*>(&len), sizeof(len)) &&
+               write_all(fd, msg.data(), msg.size());
+    }
+
+    static bool receive_message(int fd, std::string& msg) {
+        uint32_t len;
+        if (!read_all(fd, reinterpret_cast<char*>(&len), sizeof(len))) return false;
+        if (len > MAX_MESSAGE_SIZE) return false;
+        msg.resize(len);
+        return read_all(fd, &msg[0], len);
+    }
+
+    static bool make_address(const std::string& socket_path, sockaddr_un& addr) {
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(addr.sun_path)) return false;
+        std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+        return true;
+    }
+
+    static int connect_to(const std::string& socket_path) {
+        sockaddr_un addr;
+        if (!make_address(socket_path, addr)) return -1;
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+
+    // The parse of every file asked about, by canonical path, kept up to date
+    // as the file changes by re-parsing only what the change touched. The
+    // source is read again when the file's identity, size or modification
+    // time, or the name it's shown as, change. Sources are private copies,
+    // so editing a file can't change a source that's still in use. A
+    // superseded source is freed once the last request using it is done.
+    struct CachedFile {
+        std::mutex mutex;
+        dev_t dev;
+        ino_t ino;
+        off_t size;
+        struct timespec mtime;
+        uint32_t max_nesting;
+        std::unique_ptr<IncrementalParse> parse;
+        uint64_t last_used; // Guarded by file_cache_mutex.
+    };
+
+    // Beyond this many files the least recently used one is forgotten, so
+    // files that were deleted or are no longer asked about go away.
+    static const size_t MAX_CACHED_FILES = 256;
+
+    static std::mutex file_cache_mutex;
+    static std::map<std::string, std::shared_ptr<CachedFile>> file_cache;
+    static uint64_t file_cache_clock = 0;
+
+    static std::shared_ptr<CachedFile> cached_file(const std::string& path) {
+        std::lock_guard<std::mutex> lock(file_cache_mutex);
+        auto& entry = file_cache[path];
+        if (!entry) {
+            entry.reset(new CachedFile);
+            if (file_cache.size() > MAX_CACHED_FILES) {
+                auto oldest = file_cache.end();
+                for (auto it = file_cache.begin(); it != file_cache.end(); ++it) {
+                    if (it->second == entry) continue;
+                    if (oldest == file_cache.end() || it->second->last_used < oldest->second->last_used) oldest = it;
+                }
+
+                // Requests still using it keep it alive until they're done.
+                file_cache.erase(oldest);
+            }
+        }
+
+        entry->last_used = ++file_cache_clock;
+        return entry;
+    }
+
+    static void forget_file(const std::string& path) {
+        std::lock_guard<std::mutex> lock(file_cache_mutex);
+        file_cache.erase(path);
+    }
+
+    // The errors refer to src, which must be kept until they're formatted.
+    static ParseResult parse_cached(const std::string& path, const std::string& name, uint32_t max_nesting,
+                                    SharedSource& src) {
+        char resolved[PATH_MAX];
+        struct stat st;
+        if (!realpath(path.c_str(), resolved) || stat(resolved, &st) < 0) {
+            int error = errno;
+            forget_file(path);
+            throw FilesystemError(std::strerror(error));
+        }
+
+        // Pipes and devices have no meaningful identity to cache on.
+        if (!S_ISREG(st.st_mode)) {
+            src = read_file_shared(resolved, name);
+            return parse(*src, ParseMode::STREAMING, nullptr, max_nesting);
+        }
+
+        std::shared_ptr<CachedFile> cached = cached_file(resolved);
+        std::lock_guard<std::mutex> lock(cached->mutex);
+        bool changed = !cached->parse || cached->dev != st.st_dev || cached->ino != st.st_ino ||
+                       cached->size != st.st_size || cached->mtime.tv_sec != st.st_mtim.tv_sec ||
+                       cached->mtime.tv_nsec != st.st_mtim.tv_nsec || cached->parse->source()->name != name;
+        src = changed ? read_file_shared(resolved, name) : cached->parse->source();
+        if (!cached->parse || cached->max_nesting != max_nesting) {
+            cached->parse.reset(new IncrementalParse(src, max_nesting));
+            cached->max_nesting = max_nesting;
+        } else if (changed) {
+            cached->parse->update(src);
+        }
+
+        cached->dev = st.st_dev;
+        cached->ino = st.st_ino;
+        cached->size = st.st_size;
+        cached->mtime = st.st_mtim;
+
+        ParseResult result;
+        for (auto& error : cached->parse->errors()) result.errors.emplace_back(error->clone());
+        return result;
+    }
+
+    static void serve_client(int fd, const DriverOptions& server_opts) {
+        OP_SCOPE_EXIT { close(fd); };
+
+        std::string request;
+        if (!receive_message(fd, request)) return;
+
+        MessageReader reader{request, 0};
+        uint32_t jobs, max_nesting, num_files;
+        std::string cwd;
+        if (!reader.u32(jobs) || !reader.u32(max_nesting) ||
+            !reader.str(cwd) || !reader.u32(num_files)) {
+            return;
+        }
+
+        std::vector<std::string> files;
+        for (uint32_t i = 0; i < num_files; ++i) {
+            std::string file;
+            if (!reader.str(file)) return;
+            files.push_back(std::move(file));
+        }
+
+        DriverOptions opts = server_opts;
+        if (jobs) opts.jobs = jobs;
+        opts.max_nesting = max_nesting;
+
+        // Keeps the sources of this request alive until its output is done.
+        std::mutex loaded_mutex;
+        std::vector<SharedSource> loaded;
+        opts.parse_file = [&](const std::string& file) {
+            SharedSource src;
+            ParseResult result = parse_cached(file[0] == '/' ? file : cwd + "/" + file, file, max_nesting, src);
+            std::lock_guard<std::mutex> lock(loaded_mutex);
+            loaded.push_back(src);
+            return result;
+        };
+
+        std::string output;
+        bool ok = compile_files(files, opts, [&](const std::string& text) { output += text; });
+
+        MessageWriter response;
+        response.u32(ok);
+        response.data += output;
+        send_message(fd, response.data);
+    }
+
+    int run_server(const std::string& socket_path, const DriverOptions& opts) {
+        // Clients that hang up shouldn't take the server down.
+        std::signal(SIGPIPE, SIG_IGN);
+
+        sockaddr_un addr;
+        if (!make_address(socket_path, addr)) {
+            op::printf("error: {}: socket path too long\n", socket_path);
+            return 1;
+        }
+
+        // A socket nobody listens on is left over from a previous server.
+        struct stat st;
+        if (stat(socket_path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                op::printf("error: {}: exists and is not a socket\n", socket_path);
+                return 1;
+            }
+
+            int existing = connect_to(socket_path);
+            if (existing >= 0) {
+                close(existing);
+                op::printf("error: {}: a server is already running\n", socket_path);
+                return 1;
+            }
+
+            unlink(socket_path.c_str());
+        }
+
+        // Only the owner may connect, as requests name files to read.
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            chmod(socket_path.c_str(), 0600) < 0 || listen(listen_fd, SOMAXCONN) < 0) {
+            op::printf("error: {}: {}\n", socket_path, std::strerror(errno));
+            return 1;
+        }
+
+        std::mutex active_mutex;
+        std::condition_variable active_cv;
+        unsigned active = 0;
+        while (true) {
+            // Further clients wait in the listen backlog.
+            {
+                std::unique_lock<std::mutex> lock(active_mutex);
+                active_cv.wait(lock, [&] { return active < MAX_CONNECTIONS; });
+            }
+
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                op::printf("error: {}: {}\n", socket_path, std::strerror(errno));
+
+                // The connections use the state above, so they must be done
+                // before it goes away.
+                close(listen_fd);
+                std::unique_lock<std::mutex> lock(active_mutex);
+                active_cv.wait(lock, [&] { return active == 0; });
+                return 1;
+            }
+
+            // Don't let a client that stops talking hold its slot forever.
+            timeval timeout = {CLIENT_TIMEOUT, 0};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            {
+                std::lock_guard<std::mutex> lock(active_mutex);
+                ++active;
+            }
+
+            std::thread([&, fd] {
+                serve_client(fd, opts);
+                std::lock_guard<std::mutex> lock(active_mutex);
+                --active;
+                active_cv.notify_one();
+            }).detach();
+        }
+    }
+
+    int run_client(const std::string& socket_path, const std::vector<std::string>& files,
+                   unsigned jobs, uint32_t max_nesting) {
+        for (auto& file : files) {
+            if (file == "-") {
+                op::printf("error: reading from stdin is not supported with --client\n");
+                return 1;
+            }
+        }
+
+        char cwd[PATH_MAX];
+        if (!getcwd(cwd, sizeof(cwd))) {
+            op::printf("error: {}\n", std::strerror(errno));
+            return 1;
+        }
+
+        MessageWriter request;
+        request.u32(jobs);
+        request.u32(max_nesting);
+        request.str(cwd);
+        request.u32(files.size());
+        for (auto& file : files) request.str(file);
+
+        int fd = connect_to(socket_path);
+        if (fd < 0) {
+            op::printf("error: {}: can't connect to server: {}\n", socket_path, std::strerror(errno));
+            return 1;
+        }
+
+        OP_SCOPE_EXIT { close(fd); };
+        std::string response;
+        if (!send_message(fd, request.data) || !receive_message(fd, response) || response.size() < 4) {
+            op::printf("error: {}: lost connection to server\n", socket_path);
+            return 1;
+        }
+
+        MessageReader reader{response, 0};
+        uint32_t ok;
+        reader.u32(ok);
+        std::fwrite(response.data() + reader.pos, 1, response.size() - reader.pos, stdout);
+        return ok ? 0 : 1;
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef KWIK_SERVER_H
+#define KWIK_SERVER_H
+
+#include <string>
+#include <vector>
+
+#include "driver.h"
+
+
+namespace kwik {
+    // Runs a compile server on a Unix domain socket at socket_path until
+    // killed. It keeps the parses of the files it was asked about recently
+    // and updates them incrementally when the files change, so it always
+    // parses incrementally and ignores opts.mode and opts.cache. opts.jobs
+    // is the default for clients that don't ask for a number of threads.
+    int run_server(const std::string& socket_path, const DriverOptions& opts);
+
+    // Sends files to the server at socket_path and prints its output. Relative
+    // file names are resolved against the client's working directory. jobs
+    // of 0 leaves the choice to the server.
+    int run_client(const std::string& socket_path, const std::vector<std::string>& files,
+                   unsigned jobs, uint32_t max_nesting);
+}
+
+#endif
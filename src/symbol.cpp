@@ -0,0 +1,101 @@
+#include "precompile.h"
+
+#include <cstring>
+
+#include "symbol.h"
+
+
+namespace kwik {
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    static uint32_t hash_bytes(const char* str, size_t len) {
+        // Identifiers are short, so hash eight bytes at a time.
+        uint64_t h = len * 0x9e3779b97f4a7c15ull;
+        while (len >= 8) {
+            uint64_t w; std::memcpy(&w, str, 8);
+            h = (h ^ w) * 0xff51afd7ed558ccdull;
+            str += 8; len -= 8;
+        }
+
+        if (len) {
+            uint64_t w = 0; std::memcpy(&w, str, len);
+            h = (h ^ w) * 0xff51afd7ed558ccdull;
+        }
+
+        return uint32_t(h >> 32) ^ uint32_t(h);
+    }
+
+    SymbolTable::Shard::Shard() : slots(64), chunk_pos(nullptr), chunk_left(0) { }
+
+    SymbolTable::SymbolTable() { }
+
+    const char* SymbolTable::Shard::store(const char* str, size_t len) {
+        if (len > chunk_left) {
+            size_t size = std::max(len, CHUNK_SIZE);
+            chunks.emplace_back(new char[size]);
+            chunk_pos = chunks.back().get();
+            chunk_left = size;
+        }
+
+        char* result = chunk_pos;
+        std::memcpy(result, str, len);
+        chunk_pos += len;
+        chunk_left -= len;
+        return result;
+    }
+
+    void SymbolTable::Shard::grow() {
+        std::vector<Slot> new_slots(slots.size() * 2);
+        size_t mask = new_slots.size() - 1;
+        for (const Slot& slot : slots) {
+            if (!slot.sym_plus_one) continue;
+            size_t i = slot.hash & mask;
+            while (new_slots[i].sym_plus_one) i = (i + 1) & mask;
+            new_slots[i] = slot;
+        }
+
+        slots.swap(new_slots);
+    }
+
+    Symbol SymbolTable::intern(const char* str, size_t len) {
+        uint32_t hash = hash_bytes(str, len);
+        uint32_t shard_index = hash >> (32 - SHARD_BITS);
+        Shard& shard = shards[shard_index];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto& slots = shard.slots;
+        auto& entries = shard.entries;
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i].sym_plus_one) {
+            if (slots[i].hash == hash) {
+                uint32_t index = slots[i].sym_plus_one - 1;
+                const Entry& e = entries[index];
+                if (e.len == len && !std::memcmp(e.str, str, len)) {
+                    return (index << SHARD_BITS) | shard_index;
+                }
+            }
+
+            i = (i + 1) & mask;
+        }
+
+        uint32_t index = entries.size();
+        entries.push_back({shard.store(str, len), uint32_t(len)});
+        slots[i] = {hash, index + 1};
+
+        // Keep the load factor at or below one half.
+        if (2 * entries.size() > slots.size()) shard.grow();
+        return (index << SHARD_BITS) | shard_index;
+    }
+
+    SymbolTable::Entry SymbolTable::entry(Symbol sym) const {
+        const Shard& shard = shards[sym & (NUM_SHARDS - 1)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.entries[sym >> SHARD_BITS];
+    }
+
+    SymbolTable& symbols() {
+        static SymbolTable table;
+        return table;
+    }
+}
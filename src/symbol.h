@@ -0,0 +1,67 @@
+#ifndef KWIK_SYMBOL_H
+#define KWIK_SYMBOL_H
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <mutex>
+
+
+namespace kwik {
+    // An interned identifier. Two identifiers are equal iff their symbols are.
+    using Symbol = uint32_t;
+
+    // Safe to use from multiple threads. The table is split into shards by
+    // hash, each with its own lock, so concurrent lexers rarely contend.
+    class SymbolTable {
+    public:
+        SymbolTable();
+        Symbol intern(const char* str, size_t len);
+
+        const char* data(Symbol sym) const { return entry(sym).str; }
+        size_t size(Symbol sym) const { return entry(sym).len; }
+        std::string str(Symbol sym) const { return {data(sym), size(sym)}; }
+
+    private:
+        struct Entry {
+            const char* str;
+            uint32_t len;
+        };
+
+        // Slots keep the hash so most mismatches never touch the entry.
+        struct Slot {
+            uint32_t hash;
+            uint32_t sym_plus_one; // 0 if empty.
+        };
+
+        // Open addressing with linear probing. Strings are stored in arena
+        // chunks, so pointers to them stay valid while the shard grows.
+        struct Shard {
+            Shard();
+            const char* store(const char* str, size_t len);
+            void grow();
+
+            mutable std::mutex mutex;
+            std::vector<Entry> entries;
+            std::vector<Slot> slots;
+            std::vector<std::unique_ptr<char[]>> chunks;
+            char* chunk_pos;
+            size_t chunk_left;
+        };
+
+        // The low SHARD_BITS of a symbol are its shard, the rest its index
+        // in that shard. Shards are picked by the top bits of the hash, slots
+        // by the bottom bits.
+        static constexpr int SHARD_BITS = 4;
+        static constexpr int NUM_SHARDS = 1 << SHARD_BITS;
+
+        Entry entry(Symbol sym) const;
+
+        Shard shards[NUM_SHARDS];
+    };
+
+    SymbolTable& symbols();
+}
+
+#endif
@@ -6,7 +6,7 @@
 
 
 namespace kwik {
-    std::string Token::as_str() {
+    std::string Token::as_str() const {
         switch (type) {
         case 0: return "EOF";
         case KWIK_TOK_NL: return "\\n";
@@ -19,9 +19,8 @@ namespace kwik {
         case KWIK_TOK_EQUALS: return "=";
         case KWIK_TOK_LET: return "let";
         case KWIK_TOK_RETURN: return "return";
-        case KWIK_TOK_NUM:
-        case KWIK_TOK_NAME:
-             return val;
+        case KWIK_TOK_NUM: return str(source_of(loc));
+        case KWIK_TOK_NAME: return symbols().str(sym);
         }
 
         throw InternalCompilerError(op::format("unknown token type {}", type));
@@ -6,31 +6,45 @@
 
 #include "grammar.h"
 #include "io.h"
+#include "symbol.h"
 
 
 namespace kwik {
-    struct Token {
-        Token(int type, SourceRef ref)
-        : type(type), val(), ref(ref) { }
-
-        Token(int type, const std::string& val, SourceRef ref)
-        : type(type), val(val), ref(ref) { }
-
-        ~Token() { }
+    enum class NumSuffix : uint8_t {
+        NONE = 0,
+        I,
+        I8, I16, I32, I64,
+        U8, U16, U32, U64,
+        F32, F64,
+    };
 
+    // Tokens are plain values. Their text isn't stored, it's a view of len
+    // bytes into the source code at loc. Names carry their interned symbol.
+    struct Token {
         int type;
-        std::string val;
-        SourceRef ref;
+        SourceLoc loc;
+        uint32_t len;
+
+        // Numbers are parsed completely by the lexer. Floats are stored as
+        // double, f32 literals already rounded to float.
+        struct Number {
+            union {
+                uint64_t value;
+                double fvalue;
+            };
+            uint8_t base;
+            bool floating;
+            NumSuffix suffix;
+        };
 
         union {
-            struct {
-                int base;
-                bool floating;
-                int suffix_len;
-            } number;
+            Number number;
+            Symbol sym;
         };
 
-        std::string as_str();
+        const char* text(const Source& src) const { return src.code.get() + src.offset(loc); }
+        std::string str(const Source& src) const { return {text(src), len}; }
+        std::string as_str() const;
     };
     
 }
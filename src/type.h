@@ -7,12 +7,16 @@ namespace kwik {
     enum class Type {
         UNKNOWN = 0,
         I64,
+        F32,
+        F64,
     };
 
     inline std::string type_name(Type type) {
         switch (type) {
         case Type::UNKNOWN: return "Unknown";
         case Type::I64: return "I64";
+        case Type::F32: return "F32";
+        case Type::F64: return "F64";
         }
 
         throw InternalCompilerError("type_name unexpected type");
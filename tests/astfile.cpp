@@ -0,0 +1,226 @@
+// Round-trips programs through the AST file format: writes them, maps the file,
+// materializes the AST again and checks it. The result must be the same AST,
+// with the same diagnostics from the checker, also when it comes from the
+// parse cache. Also checks that AstView rejects files whose records don't fit
+// together, and survives corrupted ones.
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+#include "libop/op.h"
+
+#include "astfile.h"
+#include "cache.h"
+#include "incremental.h"
+#include "grammar.h"
+#include "test.h"
+
+using namespace kwik;
+using namespace kwik::ast;
+
+
+// Writes the AST with token types and locations relative to the start of src.
+static void dump(Node* node, const Source& src, std::ostringstream& out) {
+    out << node->ast_type() << "/" << int(node->token.type) << "@" << src.offset(node->token.loc)
+        << "+" << node->token.len;
+    if (auto compound = dyn_cast<CompoundStmt>(node)) {
+        out << "[";
+        for (auto stmt : compound->stmt_list) {
+            dump(stmt, src, out);
+            out << ",";
+        }
+
+        out << "]";
+    } else if (auto let = dyn_cast<LetStmt>(node)) {
+        out << "(" << symbols().str(let->name);
+        if (let->has_typedecl) out << ":" << symbols().str(let->typedecl);
+        out << "=";
+        dump(let->expr, src, out);
+        out << ")";
+    } else if (auto ret = dyn_cast<ReturnStmt>(node)) {
+        out << "(";
+        dump(ret->expr, src, out);
+        out << ")";
+    } else if (auto name = dyn_cast<NameExpr>(node)) {
+        out << "'" << symbols().str(name->name) << "'";
+    } else if (auto number = dyn_cast<NumberExpr>(node)) {
+        auto& num = number->token.number;
+        out << "#" << num.value << "/" << int(num.base) << "/" << num.floating << "/" << int(num.suffix);
+    }
+}
+
+static std::string describe(CompoundStmt* program, const Source& src) {
+    std::ostringstream out;
+    dump(program, src, out);
+
+    Environment env;
+    try {
+        check(program, env);
+        out << "\nchecked";
+    } catch (const CompilationError& e) {
+        out << "\n" << e.what();
+    }
+
+    return out.str();
+}
+
+static std::string write_temp(const std::string& data) {
+    char path[] = "/tmp/kwik-test-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, data.data(), data.size()) != ssize_t(data.size())) {
+        std::printf("can't write %s\n", path);
+        std::exit(1);
+    }
+
+    close(fd);
+    return path;
+}
+
+// Whether the view rejects data, copied to aligned memory.
+static bool rejected(const std::string& data) {
+    std::vector<uint32_t> aligned((data.size() + 3) / 4);
+    std::memcpy(aligned.data(), data.data(), data.size());
+    try {
+        AstView view(reinterpret_cast<const char*>(aligned.data()), data.size());
+        return false;
+    } catch (const FilesystemError&) {
+        return true;
+    }
+}
+
+static void remove_dir(const std::string& dir) {
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* ent = readdir(d)) {
+            if (ent->d_name[0] != '.') unlinkat(dirfd(d), ent->d_name, 0);
+        }
+
+        closedir(d);
+    }
+
+    rmdir(dir.c_str());
+}
+
+static AstRecord& record(std::string& data, uint32_t i) {
+    auto header = reinterpret_cast<const AstFileHeader*>(data.data());
+    return reinterpret_cast<AstRecord*>(&data[header->nodes_offset])[i];
+}
+
+int main() {
+    const char* programs[] = {
+        "{}",
+        "{\n    let x = 1\n    let y: I64 = x\n    return y\n}\n",
+        "{ let a = 0x1f; let b = 0.5f32; { let c = (a); { return 12345678901234i64 } } ; 7 }",
+        "{\n    let big = 18446744073709551615u64\n    let f = 1e300\n    let s = .25\n    x\n}",
+        "{\n    let t: U8 = 1\n    return t\n    return missing\n}",
+        "{ { } { { } } let n = 3; n }",
+    };
+
+    for (const char* code : programs) {
+        IncrementalParse parsed(make_source_shared(code, "test.kw"));
+        CHECK(parsed.program(), "can't parse %s", code);
+        if (!parsed.program()) continue;
+
+        const Source& src = *parsed.source();
+        std::string want = describe(parsed.program(), src);
+        std::string data = write_ast(parsed.program(), src);
+        std::string path = write_temp(data);
+
+        try {
+            MappedAst mapped(path);
+            AstArena arena;
+            std::string got = describe(materialize_ast(mapped.view(), src, arena), src);
+            CHECK(got == want, "round trip of %s gave\n%s\n--- instead of:\n%s", code, got.c_str(), want.c_str());
+        } catch (const FilesystemError& e) {
+            CHECK(false, "can't read back %s: %s", code, e.what());
+        }
+
+        unlink(path.c_str());
+    }
+
+    // The parse cache keeps the program too, and rebuilds it on a hit if
+    // given an arena.
+    char dir[] = "/tmp/kwik-test-XXXXXX";
+    if (!mkdtemp(dir)) {
+        std::printf("can't create %s\n", dir);
+        return 1;
+    }
+
+    {
+        ParseCache cache(dir, 1 << 20);
+        for (const char* code : programs) {
+            const Source& src = make_source(code, "test.kw");
+            AstArena arena;
+            ParseResult parsed = parse(src, ParseMode::STREAMING, &arena);
+            cache.store(src, DEFAULT_MAX_NESTING, parsed);
+
+            ParseResult hit;
+            CHECK(cache.lookup(src, DEFAULT_MAX_NESTING, hit) && !hit.program, "cache lookup of %s", code);
+            AstArena cached_arena;
+            ParseResult full;
+            CHECK(cache.lookup(src, DEFAULT_MAX_NESTING, full, &cached_arena) && full.program,
+                  "cache lookup of %s with an arena", code);
+            if (!full.program) continue;
+
+            std::string want = describe(parsed.program, src);
+            std::string got = describe(full.program, src);
+            CHECK(got == want, "cached %s gave\n%s\n--- instead of:\n%s", code, got.c_str(), want.c_str());
+        }
+    }
+
+    remove_dir(dir);
+
+    // Records that are each fine but don't fit together.
+    IncrementalParse parsed(make_source_shared("{\n    let x = 1\n    return x\n}", "test.kw"));
+    std::string data = write_ast(parsed.program(), *parsed.source());
+    CHECK(!rejected(data), "%s", "a valid file was rejected");
+
+    // The records are: 1, let x, x, return, the compound.
+    std::string bad = data;
+    record(bad, 0).token_type = KWIK_TOK_NAME;
+    CHECK(rejected(bad), "%s", "a number with a name token was accepted");
+    bad = data;
+    record(bad, 4).token_type = KWIK_TOK_LET;
+    CHECK(rejected(bad), "%s", "a compound with a let token was accepted");
+
+    // From { 5; return 2 }, with records 5, 2, return, the compound, make
+    // { return (return 5) }.
+    IncrementalParse nested(make_source_shared("{ 5; return 2 }", "test.kw"));
+    bad = write_ast(nested.program(), *nested.source());
+    CHECK(!rejected(bad), "%s", "a valid file was rejected");
+    record(bad, 1).kind = AstRecordKind::RETURN;
+    record(bad, 1).token_type = KWIK_TOK_RETURN;
+    record(bad, 1).a = 0;
+    record(bad, 3).a = 1;
+    record(bad, 3).b = 1;
+    CHECK(rejected(bad), "%s", "a return used as an expression was accepted");
+
+    // Anything else the view accepts must materialize and check safely.
+    std::mt19937 rng(1);
+    AstArena arena;
+    int accepted = 0;
+    for (int i = 0; i < 20000; ++i) {
+        bad = data;
+        for (int flips = 1 + rng() % 3; flips; --flips) bad[rng() % bad.size()] ^= char(1 << rng() % 8);
+        std::vector<uint32_t> aligned((bad.size() + 3) / 4);
+        std::memcpy(aligned.data(), bad.data(), bad.size());
+        try {
+            AstView view(reinterpret_cast<const char*>(aligned.data()), bad.size());
+            describe(materialize_ast(view, *parsed.source(), arena), *parsed.source());
+            ++accepted;
+        } catch (const FilesystemError&) {
+        } catch (const InternalCompilerError&) {
+            // A different code size.
+        }
+    }
+
+    std::printf("%d of 20000 corrupted files accepted\n", accepted);
+    return test::finish("astfile");
+}
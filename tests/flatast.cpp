@@ -0,0 +1,151 @@
+// Checks random programs both as pointer ASTs and as flat ASTs. The flat
+// checker must report the same thing as ast::check: either no error, or the
+// same first error at the same place. About half of the programs are kept
+// free of errors, the rest use undefined names, redefine names and declare
+// wrong types.
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include "libop/op.h"
+
+#include "flatast.h"
+#include "parser.h"
+#include "test.h"
+
+using namespace kwik;
+
+
+struct Generator {
+    std::mt19937 rng;
+    bool valid;
+
+    // The names bound in each enclosing block and their types, innermost
+    // last. Only valid programs keep track of them.
+    std::vector<std::vector<std::pair<std::string, const char*>>> scopes;
+
+    bool chance(int percent) { return int(rng() % 100) < percent; }
+
+    const char* literal(const char*& type) {
+        static const char* literals[][2] = {
+            {"1", "I64"}, {"0x1f", "I64"}, {"7i64", "I64"}, {"2.5", "F64"}, {".25", "F64"}, {"0.5f32", "F32"},
+        };
+        auto& lit = literals[rng() % 6];
+        type = lit[1];
+        return lit[0];
+    }
+
+    std::string expr(const char*& type) {
+        if (chance(20)) return "(" + expr(type) + ")";
+        if (!valid) {
+            type = "I64";
+            if (chance(50)) return std::string(1, char('a' + rng() % 6));
+            return literal(type);
+        }
+
+        size_t bound = 0;
+        for (auto& scope : scopes) bound += scope.size();
+        if (!bound || chance(40)) return literal(type);
+
+        // Any name in scope, which may be shadowed by a later one.
+        size_t n = rng() % bound;
+        for (auto& scope : scopes) {
+            if (n < scope.size()) {
+                std::string name = scope[n].first;
+                for (auto& inner : scopes) {
+                    for (auto& binding : inner) {
+                        if (binding.first == name) type = binding.second;
+                    }
+                }
+
+                return name;
+            }
+
+            n -= scope.size();
+        }
+
+        return literal(type);
+    }
+
+    void let(std::string& code) {
+        const char* type;
+        std::string name;
+        if (valid) name = op::format("v{}", scopes.back().size());
+        else name = std::string(1, char('a' + rng() % 6));
+
+        std::string init = expr(type);
+        code += "let " + name;
+        if (chance(40)) {
+            static const char* types[] = {"I64", "F32", "F64", "U8"};
+            code += ": ";
+            code += valid ? type : types[rng() % 4];
+        }
+
+        code += " = " + init;
+        if (valid) scopes.back().emplace_back(name, type);
+    }
+
+    void block(std::string& code, int depth) {
+        code += "{";
+        scopes.emplace_back();
+        for (int n = rng() % 6; n; --n) {
+            code += chance(50) ? "\n" : " ";
+            uint32_t kind = rng() % 10;
+            const char* type;
+            if (kind < 5) let(code);
+            else if (kind < 7 && depth < 5) block(code, depth + 1);
+            else if (kind < 8) code += "return " + expr(type);
+            else code += expr(type);
+            if (n > 1) code += ";";
+        }
+
+        scopes.pop_back();
+        code += " }";
+    }
+};
+
+// What a checker reports: "checked" or the first error.
+template<class F>
+static std::string outcome(F check) {
+    try {
+        check();
+        return "checked";
+    } catch (const CompilationError& e) {
+        return e.what();
+    }
+}
+
+int main() {
+    Generator gen;
+    gen.rng.seed(1);
+    int checked = 0, erroneous = 0;
+    for (int i = 0; i < 3000; ++i) {
+        gen.valid = i % 2 == 0;
+        std::string code;
+        gen.block(code, 0);
+
+        const Source& src = make_source(code, "test.kw");
+        AstArena arena;
+        ParseResult result = parse(src, ParseMode::STREAMING, &arena);
+        CHECK(result.program, "can't parse %s", code.c_str());
+        if (!result.program) continue;
+
+        ast::Environment env;
+        std::string want = outcome([&] { ast::check(result.program, env); });
+        TokenBuffer tokens;
+        Lexer{src}.lex_all(tokens);
+        std::string got = outcome([&] { check(flatten(result.program, tokens), tokens); });
+        CHECK(got == want, "flat check of\n%s\ngave: %s\ninstead of: %s", code.c_str(), got.c_str(), want.c_str());
+        CHECK(!gen.valid || want == "checked", "valid program\n%s\ngave: %s", code.c_str(), want.c_str());
+
+        if (want == "checked") ++checked;
+        else ++erroneous;
+    }
+
+    std::printf("%d programs checked, %d with errors\n", checked, erroneous);
+    CHECK(erroneous > 500, "only %d programs with errors", erroneous);
+    return test::finish("flatast");
+}
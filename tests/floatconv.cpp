@@ -0,0 +1,120 @@
+// Checks parse_f32 and parse_f64 against strtof and strtod, bit for bit, on:
+// - a sample of every binade of positive floats, printed at 6 to 9
+//   significant digits;
+// - the exact midpoints between adjacent floats, the doubles right next to
+//   them and decimals closer to them than any double, where rounding to
+//   double first gives the wrong float;
+// - random doubles printed at 17 significant digits;
+// - random digit strings of up to 40 digits.
+
+#include <string>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "floatconv.h"
+#include "test.h"
+
+
+// Writes x without exponent, as the lexer sees literals, with sig
+// significant digits. If sig is 0 it uses up to 160, which is exact for the
+// midpoint of two floats and close enough for anything else.
+static std::string plain_decimal(double x, int sig) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%.*e", sig ? sig - 1 : 159, x);
+
+    std::string digits;
+    char* p = buf;
+    for (; *p != 'e'; ++p) {
+        if (*p != '.') digits += *p;
+    }
+
+    int exp = std::atoi(p + 1);
+    if (!sig) {
+        while (digits.size() > 1 && digits.back() == '0') digits.pop_back();
+    }
+
+    // The point goes after exp + 1 digits.
+    int point = exp + 1;
+    if (point <= 0) return "0." + std::string(-point, '0') + digits;
+    if (point >= int(digits.size())) return digits + std::string(point - digits.size(), '0');
+    return digits.substr(0, point) + "." + digits.substr(point);
+}
+
+// Subtracts one from the last digit of a decimal that doesn't end in zero
+// and isn't zero, or from the integer part of an integer.
+static std::string decrement(std::string s) {
+    size_t i = s.size();
+    while (s[--i] == '0') s[i] = '9';
+    --s[i];
+    return s;
+}
+
+static uint64_t num_checked = 0;
+
+static void check_f32(const std::string& s) {
+    float expected = std::strtof(s.c_str(), nullptr);
+    float got = kwik::parse_f32(s.data(), s.data() + s.size());
+    CHECK(!std::memcmp(&got, &expected, sizeof(got)), "parse_f32(%s) = %.9g, strtof gives %.9g",
+          s.c_str(), got, expected);
+    ++num_checked;
+}
+
+static void check_f64(const std::string& s) {
+    double expected = std::strtod(s.c_str(), nullptr);
+    double got = kwik::parse_f64(s.data(), s.data() + s.size());
+    CHECK(!std::memcmp(&got, &expected, sizeof(got)), "parse_f64(%s) = %.17g, strtod gives %.17g",
+          s.c_str(), got, expected);
+    ++num_checked;
+}
+
+static float float_from_bits(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+int main() {
+    std::mt19937_64 rng(1);
+
+    // 0x7f800000 is infinity, every finite positive float is below it.
+    for (uint32_t bits = 1; bits < 0x7f800000; bits += 1 + rng() % 16000) {
+        float f = float_from_bits(bits);
+        for (int sig = 6; sig <= 9; ++sig) check_f32(plain_decimal(f, sig));
+
+        float next = float_from_bits(bits + 1);
+        if (std::isinf(next)) continue;
+        double mid = (double(f) + double(next)) / 2;
+        std::string exact = plain_decimal(mid, 0);
+        bool integer = exact.find('.') == std::string::npos;
+        check_f32(exact);
+        check_f32(exact + (integer ? "." : "") + "0000000001");
+        check_f32(integer ? decrement(exact) + ".9999999999" : decrement(exact) + "9999999999");
+        check_f32(plain_decimal(std::nextafter(mid, 0.0), 0));
+        check_f32(plain_decimal(std::nextafter(mid, 1e300), 0));
+    }
+
+    for (int i = 0; i < 300000; ++i) {
+        uint64_t bits = rng() & 0x7fffffffffffffffull;
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        if (std::isinf(d) || std::isnan(d)) continue;
+        check_f64(plain_decimal(d, 17));
+    }
+
+    for (int i = 0; i < 300000; ++i) {
+        std::string s;
+        int len = 1 + rng() % 40;
+        for (int j = 0; j < len; ++j) s += char('0' + rng() % 10);
+        if (rng() % 4) s.insert(rng() % (len + 1), ".");
+        if (s == ".") s = "0";
+        check_f32(s);
+        check_f64(s);
+    }
+
+    std::printf("%llu conversions checked\n", static_cast<unsigned long long>(num_checked));
+    return test::finish("floatconv");
+}
@@ -0,0 +1,125 @@
+// Checks that IncrementalParse ends up with the same AST and diagnostics as
+// parsing the edited source from scratch, over random edits of a program:
+// inserting and removing tokens, braces, newlines, comments and carriage
+// returns, and replacing the whole source with update(). Also checks that
+// locations in versions of the source that edits left behind are rejected.
+
+#include "precompile.h"
+
+#include <string>
+#include <random>
+#include <sstream>
+#include "libop/op.h"
+
+#include "incremental.h"
+#include "parser.h"
+#include "test.h"
+
+using namespace kwik;
+using namespace kwik::ast;
+
+
+// Writes the AST with locations relative to the start of src.
+static void dump(Node* node, const Source& src, std::ostringstream& out) {
+    out << node->ast_type() << "@" << src.offset(node->token.loc) << "+" << node->token.len;
+    if (auto compound = dyn_cast<CompoundStmt>(node)) {
+        out << "[";
+        for (auto stmt : compound->stmt_list) {
+            dump(stmt, src, out);
+            out << ",";
+        }
+
+        out << "]";
+    } else if (auto let = dyn_cast<LetStmt>(node)) {
+        out << "(" << symbols().str(let->name) << ":";
+        dump(let->expr, src, out);
+        out << ")";
+    } else if (auto ret = dyn_cast<ReturnStmt>(node)) {
+        out << "(";
+        dump(ret->expr, src, out);
+        out << ")";
+    } else if (auto name = dyn_cast<NameExpr>(node)) {
+        out << "'" << symbols().str(name->name) << "'";
+    } else if (auto number = dyn_cast<NumberExpr>(node)) {
+        out << "#" << number->token.number.value << "/" << int(number->token.number.suffix);
+    }
+}
+
+static std::string describe(CompoundStmt* program, const std::vector<std::unique_ptr<CompilationError>>& errors,
+                            const Source& src) {
+    std::ostringstream out;
+    if (program) dump(program, src, out);
+    else out << "no program";
+    for (auto& error : errors) out << "\n" << error->what();
+    return out.str();
+}
+
+int main() {
+    const char* snippets[] = {
+        "{", "}", "\n", " ", "let x = 1", "let y: I64 = x", "a", "1", "9", ";", "#c\n", "(", ")",
+        "return q", "\r\n", "\n  let z = 0x1f\n", "{ let w = 2 }", "x", "5i8", ".5",
+    };
+    const size_t num_snippets = sizeof(snippets) / sizeof(*snippets);
+
+    std::string code = "{\n";
+    for (int i = 0; i < 40; ++i) code += op::format("  let v{} = {}\n  {{ let q = v{}\n return q }}\n", i, i, i);
+    code += "}\n";
+    const std::string start = code;
+    std::string good = start;
+
+    IncrementalParse inc(make_source_shared(code, "inc.kw"));
+    std::mt19937 rng(1);
+    int edits = 5000, incremental = 0;
+    for (int n = 0; n < edits; ++n) {
+        SharedSource before = inc.source();
+        size_t size = before->code_size;
+        size_t offset = rng() % (size + 1);
+        size_t len = rng() % 3 == 0 ? std::min<size_t>(rng() % 6, size - offset) : 0;
+        std::string text = rng() % 4 == 0 ? "" : snippets[rng() % num_snippets];
+
+        // Every tenth change goes through update() with the whole new code.
+        if (n % 10 == 9) {
+            std::string edited(before->code.get(), size);
+            edited.replace(offset, len, text);
+            inc.update(make_source_shared(edited, "inc.kw"));
+        } else inc.edit(offset, len, text);
+
+        if (!inc.last_stats().full) ++incremental;
+
+        const Source& now = *inc.source();
+        SharedSource fresh = make_source_shared(std::string(now.code.get(), now.code_size), "inc.kw");
+        ParseResult result = parse(*fresh);
+        IncrementalParse full(fresh);
+        std::string got = describe(inc.program(), inc.errors(), now);
+        std::string want = describe(full.program(), result.errors, *fresh);
+        CHECK(got == want, "edit %d, replacing %zu bytes at %zu with \"%s\":\n%s\n--- instead of:\n%s",
+              n, len, offset, text.c_str(), got.c_str(), want.c_str());
+
+        // Mostly go back to the last program without syntax errors, as only
+        // those can be edited incrementally, and start over now and then in
+        // case it's one whose statements don't line up with its lines.
+        bool syntax_ok = inc.program() != nullptr;
+        for (auto& error : inc.errors()) syntax_ok &= dynamic_cast<SemanticError*>(error.get()) != nullptr;
+        if (n % 20 == 19) good = start;
+        else if (syntax_ok) good = std::string(now.code.get(), now.code_size);
+        if (n % 20 == 19 || (!syntax_ok && rng() % 8)) inc.edit(0, inc.source()->code_size, good);
+    }
+
+    // Without a lot of edits done incrementally this tests nothing.
+    CHECK(incremental > edits / 5, "only %d of %d edits were incremental", incremental, edits);
+
+    IncrementalParse moved(make_source_shared(start, "stale.kw"));
+    SourceLoc old_loc = moved.program()->token.loc;
+    moved.edit(start.size() - 2, 0, "\n  let w = 1\n");
+    CHECK(moved.program()->token.loc.offset != old_loc.offset, "%s", "the program wasn't moved to the new source");
+    bool threw = false;
+    try {
+        source_of(old_loc);
+    } catch (const InternalCompilerError&) {
+        threw = true;
+    }
+
+    CHECK(threw, "%s", "a location in a released source was resolved");
+
+    return test::finish("incremental");
+}
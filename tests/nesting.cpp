@@ -0,0 +1,96 @@
+// Feeds programs nested a million levels deep through every pass over the
+// AST. With the default limit the parse must stop with a syntax error, with
+// a higher one every pass must get through without running out of native
+// stack.
+
+#include "precompile.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include "libop/op.h"
+
+#include "astfile.h"
+#include "flatast.h"
+#include "incremental.h"
+#include "parser.h"
+#include "test.h"
+
+using namespace kwik;
+
+
+static const uint32_t DEPTH = 1000000;
+
+// DEPTH nested blocks, the innermost binding a name to DEPTH nested parens.
+static std::string nested_program() {
+    std::string code;
+    code.reserve(4 * DEPTH + 16);
+    code.append(DEPTH, '{');
+    code += "let x = ";
+    code.append(DEPTH, '(');
+    code += "1";
+    code.append(DEPTH, ')');
+    code += "; x";
+    code.append(DEPTH, '}');
+    return code;
+}
+
+static bool too_deep(const std::vector<std::unique_ptr<CompilationError>>& errors) {
+    return errors.size() == 1 && std::string(errors[0]->what()).find("nesting too deep") != std::string::npos;
+}
+
+int main() {
+    std::string code = nested_program();
+    const Source& src = make_source(code, "nested.kw");
+    const uint32_t limit = 2 * DEPTH + 1;
+
+    for (ParseMode mode : {ParseMode::STREAMING, ParseMode::PRELEXED}) {
+        const char* name = mode == ParseMode::STREAMING ? "streaming" : "prelexed";
+        AstArena arena;
+        ParseResult result = parse(src, mode, &arena);
+        CHECK(!result.program && too_deep(result.errors), "%s parse within the default limit", name);
+
+        arena.reset();
+        result = parse(src, mode, &arena, limit);
+        CHECK(result.program && result.errors.empty(), "%s parse with a raised limit failed", name);
+    }
+
+    IncrementalParse shallow(make_source_shared(code, "nested.kw"));
+    CHECK(!shallow.program() && too_deep(shallow.errors()), "%s", "incremental parse within the default limit");
+
+    IncrementalParse parsed(make_source_shared(code, "nested.kw"), limit);
+    CHECK(parsed.program() && parsed.errors().empty(), "%s", "incremental parse with a raised limit failed");
+    if (!parsed.program()) return test::finish("nesting");
+    const Source& parsed_src = *parsed.source();
+
+    // Checks again what was checked in the parse, and moves every location
+    // there and back.
+    ast::Environment env;
+    ast::check(parsed.program(), env);
+    ast::relocate(parsed.program(), 1);
+    ast::relocate(parsed.program(), -1);
+
+    TokenBuffer tokens;
+    Lexer{parsed_src}.lex_all(tokens);
+    FlatAst flat = flatten(parsed.program(), tokens);
+    CHECK(flat.size() == DEPTH + 3, "flat AST has %zu nodes", flat.size());
+    check(flat, tokens);
+
+    std::string data = write_ast(parsed.program(), parsed_src);
+    std::vector<uint32_t> aligned((data.size() + 3) / 4);
+    std::memcpy(aligned.data(), data.data(), data.size());
+    AstView view(reinterpret_cast<const char*>(aligned.data()), data.size());
+    AstArena arena;
+    ast::Environment materialized_env;
+    ast::check(materialize_ast(view, parsed_src, arena), materialized_env);
+
+    // Edits in the innermost block.
+    size_t x = code.rfind('x');
+    parsed.edit(x, 1, "y");
+    CHECK(parsed.errors().size() == 1, "%s", "an undefined name was accepted");
+    parsed.edit(x, 1, "x");
+    CHECK(parsed.program() && parsed.errors().empty(), "%s", "reverting the edit failed");
+
+    return test::finish("nesting");
+}
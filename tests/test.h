@@ -0,0 +1,35 @@
+#ifndef KWIK_TEST_H
+#define KWIK_TEST_H
+
+#include <cstdio>
+
+
+// A minimal harness for the tests. A test is a program that checks things
+// with CHECK, which reports a failure and carries on, and returns finish()
+// from main.
+namespace test {
+    inline int& failures() {
+        static int n = 0;
+        return n;
+    }
+
+    // Prints a summary and returns the exit status of the test.
+    inline int finish(const char* name) {
+        if (failures()) std::printf("%s: %d failure(s)\n", name, failures());
+        else std::printf("%s: ok\n", name);
+        return failures() ? 1 : 0;
+    }
+}
+
+// Failures beyond the first few are only counted.
+#define CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            if (++test::failures() <= 10) { \
+                std::printf("%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #cond); \
+                std::printf(__VA_ARGS__); \
+                std::printf("\n"); \
+            } \
+        } \
+    } while (0)
+
+#endif